@@ -0,0 +1,901 @@
+// benchmark.cpp - per-effect and per-chain throughput benchmark
+// compile: g++ -std=c++17 -O2 benchmark.cpp effects/*.cpp -o benchmark
+//
+//   benchmark [-e name[,name]] [-s seconds] [-r rate] [-t threads] [-f table|csv|json]
+//   benchmark -m
+//   benchmark -b
+//   benchmark -c [-t threads]
+//   benchmark -R
+//   benchmark -d [-r rate]
+//   benchmark -q [-r rate]
+//
+// Every effect (and a few common chains, one of them also as a fixed
+// EffectChain, "fixed:...") is driven with sine, noise, silence and
+// decaying-impulse input at 32/64/128/256/1024-frame blocks. Silence is
+// the idle graph: after a reset there is no tail, so it skips every block. For each case
+// it reports ns/sample, realtime factor, and mean/p99 time per block as a
+// percentage of the block period, i.e. how much of one callback it eats.
+// Effects that can oversample are also run at 2x/4x/8x ("fuzz@4x"), with the
+// latency the oversampling filters add, and with first/second-order
+// anti-aliased clipping ("fuzz+adaa2"). Reverb and pingpong also run with
+// their wet path at half and quarter rate ("reverb@1/2").
+//
+// -t runs every case as a PipelinedGraph over that many worker threads, the
+// way controller.cpp -t does with the block size as the period. Heavy chains
+// then report wall time on the calling thread (waits included) and one more
+// block of latency; light ones are unchanged. It needs that many idle cores.
+//
+// -m instead checks effects/fast_math.h against libm: worst error over each
+// function's stated range and ns per call for both, at the
+// FAST_MATH_PRECISION the benchmark was compiled with.
+//
+// -b times the effects/effect_bank.h banks against as many separate
+// instances, in ns per channel-sample, for 4, 8 and 16 channels.
+//
+// -c checks the audio path for realtime safety: built with -DRT_SANITIZE
+// (see effects/rt_sanitizer.h) it prepares every case above, the banks and
+// a ChannelRack, then processes, resets and sends them the controller's
+// commands inside a ScopedRealtime, and lists every allocation, lock or
+// blocking call with a backtrace. Exits 1 if there were any.
+//
+// -R plays the same two notes through every effect and chain at 44.1, 48,
+// 88.2, 96 and 192 kHz (cabinet IR at 48 kHz, resampled by the effect) and
+// compares each output's level envelope, 20 ms windows aligned for the
+// effect's latency, with the 48 kHz one down to RATE_RANGE_DB below its
+// peak: the worst difference in dB per rate, and FAIL past
+// RATE_TOLERANCE_DB. "reverb@1/2" and the like are compared with the
+// full-rate effect, where the divided rate is still 24 kHz or more.
+// Exits 1 on any failure.
+//
+// -d feeds every effect and chain one impulse and then a minute of
+// silence, skipping switched off, and times each 256-frame block: the
+// worst second's lower-quartile block time over the first second's, with the
+// audio thread's denormal flushing (effects/denormal.h) and without. FAIL
+// and exit 1 where the flushed run goes past TAIL_COST_TOLERANCE.
+//
+// -q checks every effect's processBlock() against its per-sample process()
+// and each bank against as many single instances, bit for bit, on a
+// quarter second each of the four inputs fed in blocks of odd lengths
+// (ODD_BLOCKS). Exits 1 on any difference.
+//
+// Everything runs with denormals flushed, as the audio callback does.
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#include "effects/any_effect.h"
+#include "effects/autoswell.h"
+#include "effects/channel_rack.h"
+#include "effects/denormal.h"
+#include "effects/effect_bank.h"
+#include "effects/effect_chain.h"
+#include "effects/exciter.h"
+#include "effects/fuzz.h"
+#include "effects/phaser.h"
+#include "effects/reverb.h"
+#include "effects/rt_sanitizer.h"
+#include "effects/pipelined_graph.h"
+#include "effects/fast_math.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static const size_t BLOCK_SIZES[] = { 32, 64, 128, 256, 1024 };
+static const char* INPUTS[] = { "sine", "noise", "silence", "impulse" };
+
+// EffectGraph specs: effect names joined with '>', [a|b] for parallel branches
+static const char* CHAINS[] = {
+    "phaser>exciter>cabinet>reverb",   // controller.cpp default graph
+    "fuzz>reverb",
+    "fuzz>cabinet>reverb",
+    "autoswell>vibrato>pingpong",
+    "fuzz>[phaser|vibrato]>pingpong>reverb",
+    "fuzz@8x>exciter@4x>cabinet>reverb",           // heavy enough to pipeline
+    "fixed:phaser>exciter>reverb",                 // FixedRig, against the graph below
+    "phaser>exciter>reverb",
+};
+
+// the same rig built at compile time as an EffectChain
+static const char* FIXED_RIG = "fixed:phaser>exciter>reverb";
+using FixedRig = EffectChain<Phaser, Exciter, Reverb>;
+
+struct Options {
+    std::vector<std::string> filter;
+    double seconds = 2.0;
+    int rate = 48000;
+    std::string format = "table";
+    int threads = 1;
+    bool math = false;
+    bool banks = false;
+    bool rtCheck = false;
+    bool rates = false;
+    bool tails = false;
+    bool equivalence = false;
+};
+
+struct Result {
+    std::string name, input;
+    size_t block;
+    double nsPerSample, realtimeFactor, meanBlockPct, p99BlockPct;
+    double latencySamples;
+};
+
+// ------------------ Input signals ----------------------
+static std::vector<float> makeInput(const std::string& kind, size_t n, int rate) {
+    std::vector<float> x(n, 0.0f);
+    if (kind == "sine") {
+        for (size_t i = 0; i < n; ++i)
+            x[i] = 0.5f * (float)std::sin(2.0 * M_PI * 220.0 * (double)i / rate);
+    } else if (kind == "noise") {
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> d(-0.5f, 0.5f);
+        for (float& v : x) v = d(rng);
+    } else if (kind == "impulse") {
+        // one impulse per second, each followed by an exponential decay
+        const double tau = 0.05 * rate;
+        for (size_t i = 0; i < n; ++i)
+            x[i] = (float)std::exp(-(double)(i % (size_t)rate) / tau);
+    }
+    return x;
+}
+
+// Stand-in cabinet IR for convolution stages: 200 ms of decaying noise,
+// longer than any real cab so it exercises several FFT partitions.
+static std::vector<float> makeImpulse(int rate) {
+    std::vector<float> ir((size_t)(0.2 * rate));
+    std::mt19937 rng(99);
+    std::uniform_real_distribution<float> d(-1.0f, 1.0f);
+    const double tau = 0.03 * rate;
+    for (size_t i = 0; i < ir.size(); ++i)
+        ir[i] = 0.1f * d(rng) * (float)std::exp(-(double)i / tau);
+    return ir;
+}
+
+// ------------------ Runner ----------------------------
+// single effects run as one-node graphs, so every case pays the same
+// (per-block) graph overhead; FIXED_RIG runs a FixedRig instead
+class Chain {
+public:
+    explicit Chain(const std::string& spec, int threads = 1) {
+        if (spec == FIXED_RIG) {
+            rig.reset(new FixedRig);
+            rig->setEnabled(0, true);
+            rig->setEnabled(1, true);
+            rig->setEnabled(2, true);
+            ok = true;
+            return;
+        }
+        std::string error;
+        ok = graph.build(spec, threads, error);
+    }
+    bool valid() const { return ok; }
+    // the IR is made at irRate (default: rate) and resampled by the effect
+    void prepare(int rate, size_t block, int irRate = 0) {
+        if (rig) {
+            rig->prepare(rate);
+            return;
+        }
+        if (irRate <= 0) irRate = rate;
+        std::vector<float> ir = makeImpulse(irRate);
+        graph.setImpulse(ir.data(), ir.size(), irRate);
+        graph.prepare(rate, block);
+        right.assign(std::max(block, MAX_BLOCK), 0.0f);
+    }
+    void reset() { if (rig) rig->reset(); else graph.reset(); }
+    size_t size() const { return rig ? FixedRig::SIZE : graph.size(); }
+    void setEnabled(size_t index, bool on) {
+        if (rig) rig->setEnabled(index, on);
+        else graph.setEnabled(index, on);
+    }
+    void setParam(size_t index, int param, float value) {
+        if (rig) rig->setParam(index, param, value);
+        else graph.setParam(index, param, value);
+    }
+    // before prepare(); a FixedRig never skips
+    void setSilenceFloor(float db) { graph.setSilenceFloor(db); }
+    // left channel back into buf
+    void process(float* buf, size_t n) {
+        if (rig) rig->processBlock(buf, buf, n);
+        else graph.processBlock(buf, buf, right.data(), n);
+    }
+    double latency() const { return rig ? 0.0 : graph.latencySamples(); }
+
+private:
+    static constexpr size_t MAX_BLOCK = 1024;
+    std::unique_ptr<FixedRig> rig;
+    PipelinedGraph graph;
+    std::vector<float> right;
+    bool ok = false;
+};
+
+static Result runCase(const std::string& name, const std::string& inputKind,
+                      size_t block, const Options& opt)
+{
+    Chain chain(name, opt.threads);
+    chain.prepare(opt.rate, block);
+
+    size_t blocks = std::max<size_t>(1, (size_t)(opt.seconds * opt.rate) / block);
+    std::vector<float> input = makeInput(inputKind, blocks * block, opt.rate);
+    std::vector<float> buf(block);
+    std::vector<double> times(blocks);
+
+    // warm caches and let filters settle
+    for (size_t b = 0; b < std::min<size_t>(blocks, 64); ++b) {
+        std::copy(input.begin() + b * block, input.begin() + (b + 1) * block, buf.begin());
+        chain.process(buf.data(), block);
+    }
+    chain.reset();
+
+    volatile float sink = 0.0f;
+    for (size_t b = 0; b < blocks; ++b) {
+        std::copy(input.begin() + b * block, input.begin() + (b + 1) * block, buf.begin());
+        auto t0 = std::chrono::steady_clock::now();
+        chain.process(buf.data(), block);
+        auto t1 = std::chrono::steady_clock::now();
+        times[b] = std::chrono::duration<double, std::nano>(t1 - t0).count();
+        sink = sink + buf[block - 1];
+    }
+
+    double total = 0.0;
+    for (double t : times) total += t;
+    std::sort(times.begin(), times.end());
+    double p99 = times[std::min(times.size() - 1, (size_t)(times.size() * 0.99))];
+    double periodNs = 1e9 * (double)block / opt.rate;
+
+    Result r;
+    r.name = name;
+    r.input = inputKind;
+    r.block = block;
+    r.nsPerSample = total / (double)(blocks * block);
+    r.realtimeFactor = total > 0.0 ? periodNs * blocks / total : 0.0;
+    r.meanBlockPct = 100.0 * (total / blocks) / periodNs;
+    r.p99BlockPct = 100.0 * p99 / periodNs;
+    r.latencySamples = chain.latency();
+    return r;
+}
+
+// ------------------ Output ----------------------------
+static void printHeader(const Options& opt) {
+    if (opt.format == "csv") {
+        std::cout << "name,input,block,ns_per_sample,realtime_factor,mean_block_pct,p99_block_pct,latency_samples\n";
+    } else if (opt.format == "table") {
+        std::cout << std::left << std::setw(40) << "name" << std::setw(9) << "input"
+                  << std::right << std::setw(6) << "block" << std::setw(12) << "ns/sample"
+                  << std::setw(12) << "RT factor" << std::setw(10) << "mean %"
+                  << std::setw(10) << "p99 %" << std::setw(10) << "latency" << "\n";
+    }
+}
+
+static void printResult(const Result& r, const Options& opt) {
+    if (opt.format == "csv") {
+        std::cout << r.name << "," << r.input << "," << r.block << ","
+                  << r.nsPerSample << "," << r.realtimeFactor << ","
+                  << r.meanBlockPct << "," << r.p99BlockPct << "," << r.latencySamples << "\n";
+    } else if (opt.format == "json") {
+        std::cout << "{\"name\":\"" << r.name << "\",\"input\":\"" << r.input
+                  << "\",\"block\":" << r.block << ",\"rate\":" << opt.rate
+                  << ",\"ns_per_sample\":" << r.nsPerSample
+                  << ",\"realtime_factor\":" << r.realtimeFactor
+                  << ",\"mean_block_pct\":" << r.meanBlockPct
+                  << ",\"p99_block_pct\":" << r.p99BlockPct
+                  << ",\"latency_samples\":" << r.latencySamples << "}\n";
+    } else {
+        std::cout << std::left << std::setw(40) << r.name << std::setw(9) << r.input
+                  << std::right << std::setw(6) << r.block
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(12) << r.nsPerSample << std::setw(12) << r.realtimeFactor
+                  << std::setw(10) << r.meanBlockPct << std::setw(10) << r.p99BlockPct
+                  << std::setw(10) << r.latencySamples << std::defaultfloat << "\n";
+    }
+}
+
+// ------------------ Math accuracy ---------------------
+// ns per call over a block of inputs in [lo, hi], the way the effects call
+// them: a plain loop the compiler can vectorize
+template <typename F>
+static double mathNs(F f, double lo, double hi, double seconds) {
+    const size_t N = 256;
+    float x[N], y[N];
+    for (size_t i = 0; i < N; ++i) x[i] = (float)(lo + (hi - lo) * (double)i / N);
+
+    volatile float sink = 0.0f;
+    size_t calls = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+    while (elapsed < seconds * 1e9) {
+        for (int r = 0; r < 1000; ++r) {
+            for (size_t i = 0; i < N; ++i) y[i] = f(x[i]);
+            sink = sink + y[r & (N - 1)];
+        }
+        calls += 1000 * N;
+        elapsed = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - t0).count();
+    }
+    return elapsed / (double)calls;
+}
+
+template <typename F, typename R>
+static double mathError(F f, R ref, double lo, double hi, bool relative) {
+    const int N = 2000000;
+    double worst = 0.0;
+    for (int i = 0; i <= N; ++i) {
+        float x = (float)(lo + (hi - lo) * (double)i / N);
+        double want = ref((double)x);
+        double e = std::fabs((double)f(x) - want);
+        if (relative && want != 0.0) e /= std::fabs(want);
+        worst = std::max(worst, e);
+    }
+    return worst;
+}
+
+template <typename F, typename L, typename R>
+static void mathCase(const char* name, F fast, L libm, R ref,
+                     double lo, double hi, bool relative, const Options& opt)
+{
+    const double t = opt.seconds / 8.0;
+    double err = mathError(fast, ref, lo, hi, relative);
+    double libmErr = mathError(libm, ref, lo, hi, relative);
+    double fastNs = mathNs(fast, lo, hi, t), libmNs = mathNs(libm, lo, hi, t);
+    std::ostringstream range;
+    range << "[" << lo << ", " << hi << "]";
+    std::cout << std::left << std::setw(10) << name << std::setw(16) << range.str()
+              << std::setw(5) << (relative ? "rel" : "abs") << std::right
+              << std::scientific << std::setprecision(2)
+              << std::setw(12) << err << std::setw(12) << libmErr
+              << std::fixed << std::setw(10) << fastNs << std::setw(10) << libmNs
+              << std::defaultfloat << "\n";
+}
+
+static void runMath(const Options& opt) {
+    std::cout << "FAST_MATH_PRECISION " << FAST_MATH_PRECISION << "\n"
+              << std::left << std::setw(10) << "function" << std::setw(16) << "range"
+              << std::setw(5) << "err" << std::right << std::setw(12) << "max err"
+              << std::setw(12) << "libm err" << std::setw(10) << "ns" << std::setw(10)
+              << "libm ns" << "\n";
+    mathCase("fastSin", [](float x) { return fastSin(x); },
+             [](float x) { return std::sin(x); },
+             [](double x) { return std::sin(x); }, -10000.0, 10000.0, false, opt);
+    mathCase("fastExp", [](float x) { return fastExp(x); },
+             [](float x) { return std::exp(x); },
+             [](double x) { return std::exp(x); }, -87.0, 88.0, true, opt);
+    mathCase("fastTan", [](float x) { return fastTan(x); },
+             [](float x) { return std::tan(x); },
+             [](double x) { return std::tan(x); }, -1.5, 1.5, true, opt);
+    mathCase("fastTanh", [](float x) { return fastTanh(x); },
+             [](float x) { return std::tanh(x); },
+             [](double x) { return std::tanh(x); }, -20.0, 20.0, false, opt);
+}
+
+// ------------------ Banks -----------------------------
+// best of a few runs, ns per channel-sample
+template <typename P>
+static double bankNs(P process, size_t samples, double seconds) {
+    double best = 1e30;
+    for (int run = 0; run < 5; ++run) {
+        size_t done = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        double elapsed = 0.0;
+        while (elapsed < seconds * 1e9 / 5.0) {
+            for (int r = 0; r < 100; ++r) process();
+            done += 100 * samples;
+            elapsed = std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - t0).count();
+        }
+        best = std::min(best, elapsed / (double)done);
+    }
+    return best;
+}
+
+template <typename Bank, typename Single, size_t N>
+static void bankCase(const char* name, const Options& opt) {
+    const size_t block = 256;
+    std::vector<float> in(block * N), out(block * N), ch(block), o(block);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> d(-0.5f, 0.5f);
+    for (float& v : in) v = d(rng);
+    for (float& v : ch) v = d(rng);
+
+    Bank bank;
+    bank.prepare(opt.rate);
+    std::vector<Single> single(N);
+    for (Single& s : single) s.prepare(opt.rate);
+
+    const double t = opt.seconds / 8.0;
+    double bankTime = bankNs([&]() { bank.processBlock(in.data(), out.data(), block); },
+                             block * N, t);
+    double singleTime = bankNs([&]() {
+        for (Single& s : single) s.processBlock(ch.data(), o.data(), block);
+    }, block * N, t);
+    std::cout << std::left << std::setw(12) << name << std::right << std::setw(4) << N
+              << std::fixed << std::setprecision(2) << std::setw(10) << bankTime
+              << std::setw(10) << singleTime << std::setw(10) << singleTime / bankTime
+              << std::defaultfloat << "\n";
+}
+
+template <size_t N>
+static void bankCases(const Options& opt) {
+    bankCase<FuzzBank<N>, Fuzz, N>("fuzz", opt);
+    bankCase<ExciterBank<N>, Exciter, N>("exciter", opt);
+    bankCase<AutoSwellBank<N>, AutoSwell, N>("autoswell", opt);
+    bankCase<BitcrusherBank<N>, Bitcrusher, N>("bitcrusher", opt);
+}
+
+static void runBanks(const Options& opt) {
+    std::cout << std::left << std::setw(12) << "effect" << std::right << std::setw(4) << "N"
+              << std::setw(10) << "bank ns" << std::setw(10) << "single" << std::setw(10)
+              << "speedup" << "\n";
+    bankCases<4>(opt);
+    bankCases<8>(opt);
+    bankCases<16>(opt);
+}
+
+// ------------------ Realtime check --------------------
+static bool selected(const std::string& name, const Options& opt) {
+    if (opt.filter.empty()) return true;
+    for (const std::string& f : opt.filter)
+        if (name == f || name.find(f) != std::string::npos) return true;
+    return false;
+}
+
+// violations while f ran on a realtime thread
+template <typename F>
+static size_t realtimeCase(const std::string& name, F f) {
+    const size_t before = rtViolations();
+    {
+        ScopedRealtime rt;
+        f();
+    }
+    const size_t found = rtViolations() - before;
+    std::cout << std::left << std::setw(40) << name << (found ? "FAIL" : "ok") << "\n";
+    return found;
+}
+
+template <typename Bank>
+static size_t realtimeBank(const std::string& name, int rate) {
+    const size_t block = 256, channels = 16;
+    std::vector<float> buf(block * channels, 0.25f);
+    Bank bank;
+    bank.prepare(rate);
+    return realtimeCase(name, [&]() {
+        for (int b = 0; b < 8; ++b) bank.processBlock(buf.data(), buf.data(), block);
+        bank.reset();
+    });
+}
+
+static size_t realtimeRack(const std::string& spec, const Options& opt) {
+    const int channels = 2;
+    std::string error;
+    ChannelRack rack;
+    if (!rack.build(spec, channels, opt.threads, ChannelRack::MIX, error)) return 0;
+    std::vector<float> ir = makeImpulse(opt.rate);
+    rack.setImpulse(ir.data(), ir.size(), opt.rate);
+    rack.prepare(opt.rate, 256);
+    std::vector<float> input = makeInput("noise", 256, opt.rate), outL(256), outR(256);
+    const float* in[channels] = { input.data(), input.data() };
+    float* out[2] = { outL.data(), outR.data() };
+    return realtimeCase("rack x2 " + spec, [&]() {
+        for (int b = 0; b < 16; ++b) {
+            rack.setEnabled(b & 1, 0, b % 4 < 2);
+            rack.processBlock(in, out, 256);
+        }
+    });
+}
+
+// everything the audio thread may call after prepare(): processing at each
+// block size and input, node bypass, oversampling changes and reset()
+static int runRealtimeCheck(const std::vector<std::string>& cases, const Options& opt) {
+    if (!RT_SANITIZER_ENABLED) {
+        std::cerr << "benchmark -c needs a build with -DRT_SANITIZE\n";
+        return 1;
+    }
+    rtSanitizerAbort(false);
+
+    size_t failed = 0;
+    for (const std::string& name : cases) {
+        if (!selected(name, opt)) continue;
+        Chain chain(name, opt.threads);
+        if (!chain.valid()) continue;
+        chain.prepare(opt.rate, 256);
+        std::vector<std::vector<float>> inputs;
+        for (const char* input : INPUTS) inputs.push_back(makeInput(input, 1024, opt.rate));
+        std::vector<float> buf(1024);
+        std::unique_ptr<AnyEffect> first = AnyEffect::create(name);
+        const bool oversampled = first && first->oversampled();
+
+        failed += realtimeCase(name, [&]() {
+            for (const std::vector<float>& input : inputs) {
+                for (size_t block : BLOCK_SIZES) {
+                    std::copy(input.begin(), input.begin() + block, buf.begin());
+                    chain.process(buf.data(), block);
+                }
+            }
+            for (size_t i = 0; i < chain.size(); ++i) chain.setEnabled(i, false);
+            chain.process(buf.data(), 256);
+            for (size_t i = 0; i < chain.size(); ++i) chain.setEnabled(i, true);
+            if (oversampled)
+                for (float f : { 2.0f, 8.0f, 1.0f }) {
+                    chain.setParam(0, AnyEffect::PARAM_OVERSAMPLE, f);
+                    chain.process(buf.data(), 256);
+                }
+            chain.reset();
+            chain.process(buf.data(), 256);
+        }) > 0;
+    }
+    if (selected("bank", opt)) {
+        failed += realtimeBank<FuzzBank<16>>("bank fuzz", opt.rate) > 0;
+        failed += realtimeBank<ExciterBank<16>>("bank exciter", opt.rate) > 0;
+        failed += realtimeBank<AutoSwellBank<16>>("bank autoswell", opt.rate) > 0;
+        failed += realtimeBank<BitcrusherBank<16>>("bank bitcrusher", opt.rate) > 0;
+    }
+    if (selected("rack", opt)) failed += realtimeRack(CHAINS[0], opt) > 0;
+
+    std::cout << failed << " case(s) not realtime safe\n";
+    return failed ? 1 : 0;
+}
+
+// ------------------ Sample rates ----------------------
+static const int RATES[] = { 44100, 48000, 88200, 96000, 192000 };
+static const double RATE_TOLERANCE_DB = 1.5;
+static const double RATE_RANGE_DB = 30.0;      // compared down to this far below the peak
+// a divided wet path rounds a reverb's comb lengths at its own rate, which
+// moves the tail about as much as running the host at that rate would; it's
+// meant for wet bands under 12 kHz, so is only checked from 24 kHz up
+static const double DECIMATED_TOLERANCE_DB = 3.0;
+static const int MIN_DECIMATED_RATE = 24000;
+
+// two decaying plucks (220 Hz and 330 Hz with some 3rd harmonic) with a
+// gap between, defined in time so every rate gets the same notes
+static std::vector<float> makeNotes(int rate, double seconds) {
+    std::vector<float> x((size_t)(seconds * rate), 0.0f);
+    const double onsets[] = { 0.1, 0.9 }, pitches[] = { 220.0, 330.0 };
+    for (int k = 0; k < 2; ++k) {
+        for (size_t i = (size_t)(onsets[k] * rate); i < x.size(); ++i) {
+            double t = (double)i / rate - onsets[k];
+            double w = 2.0 * M_PI * pitches[k] * t;
+            x[i] += (float)(0.4 * std::exp(-t / 0.15) * (std::sin(w) + 0.3 * std::sin(3.0 * w)));
+        }
+    }
+    return x;
+}
+
+// level per 20 ms window in dB, from `offset` samples in
+static std::vector<double> envelopeDb(const std::vector<float>& x, size_t offset, int rate) {
+    const size_t window = (size_t)(0.02 * rate);
+    std::vector<double> env;
+    for (size_t s = offset; s + window <= x.size(); s += window) {
+        double sum = 0.0;
+        for (size_t i = s; i < s + window; ++i) sum += (double)x[i] * x[i];
+        env.push_back(10.0 * std::log10(sum / (double)window + 1e-12));
+    }
+    return env;
+}
+
+// mono (both channels averaged) output of a case at a rate
+static std::vector<float> renderAt(const std::string& name, int rate, double& latency) {
+    Chain chain(name);
+    // skipping the lead-in would stop the LFOs for a rate-dependent time
+    chain.setSilenceFloor(-INFINITY);
+    chain.prepare(rate, 256, 48000);
+    latency = chain.latency();
+    std::vector<float> x = makeNotes(rate, 2.0);
+    for (size_t done = 0; done < x.size(); done += 256)
+        chain.process(x.data() + done, std::min<size_t>(256, x.size() - done));
+    return x;
+}
+
+static int runRateCheck(const std::vector<std::string>& cases, const Options& opt) {
+    std::cout << std::left << std::setw(40) << "name" << std::right;
+    for (int rate : RATES) std::cout << std::setw(9) << rate;
+    std::cout << "  (worst dB from 48000)\n";
+
+    size_t failed = 0;
+    for (const std::string& name : cases) {
+        if (!selected(name, opt) || !Chain(name).valid()) continue;
+        // a divided-rate wet path is held to the full-rate effect
+        const size_t divided = name.find("@1/");
+        const int divide = divided == std::string::npos ? 1 : std::atoi(name.c_str() + divided + 3);
+        const double tolerance = divide > 1 ? DECIMATED_TOLERANCE_DB : RATE_TOLERANCE_DB;
+        double latency;
+        std::vector<float> ref = renderAt(name.substr(0, divided), 48000, latency);
+        std::vector<double> refEnv = envelopeDb(ref, (size_t)std::lround(latency), 48000);
+        // a reverb's tail far down is interference between its lines,
+        // which moves with sub-sample delay rounding; only the audible part counts
+        const double floorDb = *std::max_element(refEnv.begin(), refEnv.end()) - RATE_RANGE_DB;
+
+        bool ok = true;
+        std::cout << std::left << std::setw(40) << name << std::right
+                  << std::fixed << std::setprecision(2);
+        for (int rate : RATES) {
+            if (rate / divide < MIN_DECIMATED_RATE) {
+                std::cout << std::setw(9) << "-";
+                continue;
+            }
+            std::vector<float> y = renderAt(name, rate, latency);
+            std::vector<double> env = envelopeDb(y, (size_t)std::lround(latency), rate);
+            double worst = 0.0;
+            for (size_t w = 0; w < std::min(env.size(), refEnv.size()); ++w)
+                if (refEnv[w] > floorDb) worst = std::max(worst, std::fabs(env[w] - refEnv[w]));
+            ok = ok && worst <= tolerance;
+            std::cout << std::setw(9) << worst;
+        }
+        std::cout << std::defaultfloat << (ok ? "" : "  FAIL") << "\n";
+        failed += !ok;
+    }
+    std::cout << failed << " case(s) differ between rates\n";
+    return failed ? 1 : 0;
+}
+
+// ------------------ Decaying tails --------------------
+// long enough for the slowest tail (pingpong's repeats) to reach subnormals
+static const double TAIL_TEST_SECONDS = 60.0;
+static const size_t TAIL_TEST_BLOCK = 256;
+static const double TAIL_COST_TOLERANCE = 3.0;     // worst second / first; subnormals cost 10x and more
+
+// lower-quartile block time in each second after a unit impulse, ns (a
+// slow tail slows every block; other load only some); flush picks the
+// denormal mode for the run. The graph never goes idle here.
+static std::vector<double> tailCost(const std::string& name, int rate, bool flush) {
+    ScopedFlushDenormals mode(flush);
+    Chain chain(name);
+    chain.setSilenceFloor(-INFINITY);
+    chain.prepare(rate, TAIL_TEST_BLOCK);
+
+    const size_t perSecond = std::max<size_t>(1, (size_t)rate / TAIL_TEST_BLOCK);
+    const size_t blocks = (size_t)(TAIL_TEST_SECONDS * rate) / TAIL_TEST_BLOCK;
+    std::vector<float> buf(TAIL_TEST_BLOCK);
+    std::vector<double> times, seconds;
+    times.reserve(perSecond);
+    for (size_t b = 0; b < blocks; ++b) {
+        std::fill(buf.begin(), buf.end(), 0.0f);
+        if (b == 0) buf[0] = 1.0f;
+        auto t0 = std::chrono::steady_clock::now();
+        chain.process(buf.data(), TAIL_TEST_BLOCK);
+        auto t1 = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+        if (times.size() == perSecond) {
+            std::nth_element(times.begin(), times.begin() + perSecond / 4, times.end());
+            seconds.push_back(times[perSecond / 4]);
+            times.clear();
+        }
+    }
+    return seconds;
+}
+
+static int runTailCheck(const std::vector<std::string>& cases, const Options& opt) {
+    std::cout << std::left << std::setw(40) << "name" << std::right << std::setw(12) << "first ns"
+              << std::setw(10) << "worst" << std::setw(8) << "at s"
+              << std::setw(12) << "unflushed" << "  (worst second / first)\n";
+    size_t failed = 0;
+    for (const std::string& name : cases) {
+        if (!selected(name, opt) || !Chain(name).valid()) continue;
+        // worst second against the first, with and without flushing
+        double ratio[2] = { 0.0, 0.0 };
+        size_t at = 0;
+        double first = 0.0;
+        for (int flush = 1; flush >= 0; --flush) {
+            std::vector<double> s = tailCost(name, opt.rate, flush != 0);
+            if (s.empty() || s[0] <= 0.0) continue;
+            const size_t worst = std::max_element(s.begin() + 1, s.end()) - s.begin();
+            ratio[flush] = s[worst] / s[0];
+            if (flush) { at = worst; first = s[0]; }
+        }
+        const bool ok = ratio[1] <= TAIL_COST_TOLERANCE;
+        std::cout << std::left << std::setw(40) << name << std::right << std::fixed
+                  << std::setprecision(0) << std::setw(12) << first << std::setprecision(2)
+                  << std::setw(10) << ratio[1] << std::setw(8) << at
+                  << std::setw(12) << ratio[0] << std::defaultfloat << (ok ? "" : "  FAIL") << "\n";
+        failed += !ok;
+    }
+    std::cout << failed << " case(s) slow down as their tail decays\n";
+    return failed ? 1 : 0;
+}
+
+// ------------------ Block/sample equivalence ----------
+// block lengths -q cycles through: odd ones, and some past the effects'
+// internal chunks
+static const size_t ODD_BLOCKS[] = { 1, 3, 7, 31, 97, 255, 257, 1031 };
+
+// a quarter second of each input, one after the other
+static std::vector<float> makeMixedInput(int rate) {
+    std::vector<float> x;
+    for (const char* kind : INPUTS) {
+        std::vector<float> part = makeInput(kind, (size_t)rate / 4, rate);
+        x.insert(x.end(), part.begin(), part.end());
+    }
+    return x;
+}
+
+// f(offset, length) over [0, n) in ODD_BLOCKS-sized pieces
+template <typename F>
+static void inOddBlocks(size_t n, F f) {
+    const size_t count = sizeof(ODD_BLOCKS) / sizeof(ODD_BLOCKS[0]);
+    for (size_t done = 0, k = 0; done < n; ++k) {
+        const size_t m = std::min(ODD_BLOCKS[k % count], n - done);
+        f(done, m);
+        done += m;
+    }
+}
+
+// prints ok, or where want and got first differ
+static bool sameOutput(const std::string& name, const std::vector<float>& want,
+                       const std::vector<float>& got) {
+    size_t i = 0;
+    while (i < want.size() && want[i] == got[i]) ++i;
+    std::cout << std::left << std::setw(40) << name;
+    if (i == want.size()) {
+        std::cout << "ok\n";
+        return true;
+    }
+    std::cout << "FAIL at sample " << i << ": " << got[i] << " instead of " << want[i] << "\n";
+    return false;
+}
+
+// lane k of the bank against single instance k, both fed in odd blocks;
+// setup(k, bank, single) gives them the same settings
+template <typename Bank, typename Single, size_t N, typename Setup>
+static bool bankEquivalence(const std::string& name, const std::vector<float>& mono,
+                            int rate, Setup setup) {
+    const size_t frames = mono.size();
+    std::vector<float> in(frames * N), out(frames * N);
+    for (size_t i = 0; i < frames; ++i)
+        for (size_t k = 0; k < N; ++k) in[i * N + k] = mono[i] * 2.0f * (float)(k + 1) / N;
+
+    Bank bank;
+    bank.prepare(rate);
+    std::vector<Single> single(N);
+    for (size_t k = 0; k < N; ++k) {
+        single[k].prepare(rate);
+        setup(k, bank, single[k]);
+    }
+    inOddBlocks(frames, [&](size_t at, size_t m) {
+        bank.processBlock(in.data() + at * N, out.data() + at * N, m);
+    });
+
+    std::vector<float> want(frames * N), ch(frames);
+    for (size_t k = 0; k < N; ++k) {
+        for (size_t i = 0; i < frames; ++i) ch[i] = in[i * N + k];
+        inOddBlocks(frames, [&](size_t at, size_t m) {
+            single[k].processBlock(ch.data() + at, ch.data() + at, m);
+        });
+        for (size_t i = 0; i < frames; ++i) want[i * N + k] = ch[i];
+    }
+    return sameOutput(name + " x" + std::to_string(N), want, out);
+}
+
+template <size_t N>
+static size_t bankEquivalences(const std::vector<float>& mono, int rate) {
+    size_t failed = 0;
+    auto none = [](size_t, auto&, auto&) {};
+    failed += !bankEquivalence<FuzzBank<N>, Fuzz, N>("bank fuzz", mono, rate, none);
+    failed += !bankEquivalence<ExciterBank<N>, Exciter, N>("bank exciter", mono, rate,
+        [](size_t k, auto& bank, auto& single) {
+            bank.setParam(k, Exciter::PARAM_MIX, 0.06f * (float)k);
+            single.setParam(Exciter::PARAM_MIX, 0.06f * (float)k);
+        });
+    failed += !bankEquivalence<AutoSwellBank<N>, AutoSwell, N>("bank autoswell", mono, rate, none);
+    failed += !bankEquivalence<BitcrusherBank<N>, Bitcrusher, N>("bank bitcrusher", mono, rate,
+        [](size_t k, auto& bank, auto& single) {
+            for (int id : { (int)Bitcrusher::PARAM_DOWNSAMPLE, (int)Bitcrusher::PARAM_BIT_DEPTH }) {
+                const float v = id == Bitcrusher::PARAM_DOWNSAMPLE ? (float)(1 + k % 5) : (float)(3 + k);
+                bank.setParam(k, id, v);
+                single.setParam(id, v);
+            }
+        });
+    return failed;
+}
+
+static int runEquivalence(const std::vector<std::string>& cases, const Options& opt) {
+    const std::vector<float> in = makeMixedInput(opt.rate), ir = makeImpulse(opt.rate);
+    const size_t n = in.size();
+    size_t failed = 0;
+    for (const std::string& name : cases) {
+        if (!selected(name, opt)) continue;
+        std::unique_ptr<AnyEffect> ref = AnyEffect::create(name), fx = AnyEffect::create(name);
+        if (!ref) continue;        // chains
+        for (AnyEffect* e : { ref.get(), fx.get() }) {
+            e->setImpulse(ir.data(), ir.size(), opt.rate);
+            e->prepare(opt.rate);
+        }
+        // planar stereo, left then right
+        std::vector<float> want(2 * n), got(2 * n);
+        ref->processEachSample(in.data(), want.data(), want.data() + n, n);
+        inOddBlocks(n, [&](size_t at, size_t m) {
+            fx->processBlockStereo(in.data() + at, got.data() + at, got.data() + n + at, m);
+        });
+        failed += !sameOutput(name, want, got);
+    }
+    if (selected("bank", opt)) {
+        failed += bankEquivalences<4>(in, opt.rate);
+        failed += bankEquivalences<8>(in, opt.rate);
+        failed += bankEquivalences<16>(in, opt.rate);
+    }
+    std::cout << failed << " case(s) where the block path differs\n";
+    return failed ? 1 : 0;
+}
+
+// ------------------ MAIN -------------------------------
+int main(int argc, char** argv) {
+    ScopedFlushDenormals flush;     // as on the audio thread
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto value = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        if (a == "-e" || a == "--effect") {
+            std::string list = value();
+            for (size_t s = 0, e; s <= list.size(); s = e + 1) {
+                e = list.find(',', s);
+                if (e == std::string::npos) e = list.size();
+                if (e > s) opt.filter.push_back(list.substr(s, e - s));
+            }
+        }
+        else if (a == "-s" || a == "--seconds") opt.seconds = std::atof(value().c_str());
+        else if (a == "-r" || a == "--rate")    opt.rate = std::atoi(value().c_str());
+        else if (a == "-t" || a == "--threads") opt.threads = std::atoi(value().c_str());
+        else if (a == "-f" || a == "--format")  opt.format = value();
+        else if (a == "-m" || a == "--math")    opt.math = true;
+        else if (a == "-b" || a == "--banks")   opt.banks = true;
+        else if (a == "-c" || a == "--rt-check") opt.rtCheck = true;
+        else if (a == "-R" || a == "--rates")   opt.rates = true;
+        else if (a == "-d" || a == "--denormals") opt.tails = true;
+        else if (a == "-q" || a == "--equivalence") opt.equivalence = true;
+        else {
+            std::cerr << "usage: benchmark [-e name[,name]] [-s seconds] [-r rate] [-t threads] [-f table|csv|json]\n"
+                         "       benchmark -m\n"
+                         "       benchmark -b\n"
+                         "       benchmark -c [-t threads]\n"
+                         "       benchmark -R\n"
+                         "       benchmark -d [-r rate]\n"
+                         "       benchmark -q [-r rate]\n";
+            return 1;
+        }
+    }
+    if (opt.seconds <= 0.0 || opt.rate <= 0 || opt.threads < 1 ||
+        (opt.format != "table" && opt.format != "csv" && opt.format != "json")) {
+        std::cerr << "invalid option value\n";
+        return 1;
+    }
+    if (opt.math) {
+        runMath(opt);
+        return 0;
+    }
+    if (opt.banks) {
+        runBanks(opt);
+        return 0;
+    }
+
+    std::vector<std::string> cases;
+    for (const std::string& n : AnyEffect::names()) {
+        cases.push_back(n);
+        std::unique_ptr<AnyEffect> fx = AnyEffect::create(n);
+        if (fx->oversampled())
+            for (const char* f : { "@2x", "@4x", "@8x" }) cases.push_back(n + f);
+        if (fx->antialiased())
+            for (const char* a : { "+adaa1", "+adaa2" }) cases.push_back(n + a);
+        if (fx->decimates())
+            for (const char* d : { "@1/2", "@1/4" }) cases.push_back(n + d);
+    }
+    for (const char* c : CHAINS) cases.push_back(c);
+    if (opt.rtCheck) return runRealtimeCheck(cases, opt);
+    if (opt.rates) return runRateCheck(cases, opt);
+    if (opt.tails) return runTailCheck(cases, opt);
+    if (opt.equivalence) return runEquivalence(cases, opt);
+
+    printHeader(opt);
+    for (const std::string& name : cases) {
+        if (!selected(name, opt) || !Chain(name).valid()) continue;
+        for (const char* input : INPUTS)
+            for (size_t block : BLOCK_SIZES)
+                printResult(runCase(name, input, block, opt), opt);
+    }
+    return 0;
+}
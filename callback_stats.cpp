@@ -0,0 +1,185 @@
+#include "callback_stats.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+// ---------------- CycleCounter ----------------
+
+double CycleCounter::calibrate() {
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t c0 = now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto t1 = std::chrono::steady_clock::now();
+    uint64_t c1 = now();
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    return ns > 0.0 ? (double)(c1 - c0) / ns : 1.0;
+}
+
+// ---------------- CallbackStats ----------------
+
+static void atomicMax(std::atomic<uint64_t>& a, uint64_t v) {
+    uint64_t cur = a.load(std::memory_order_relaxed);
+    while (v > cur && !a.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {}
+}
+
+static void atomicMin(std::atomic<int64_t>& a, int64_t v) {
+    int64_t cur = a.load(std::memory_order_relaxed);
+    while (v < cur && !a.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {}
+}
+
+void CallbackStats::record(uint64_t startTicks, uint64_t endTicks, unsigned long frames,
+                           double sampleRate, const PaStreamCallbackTimeInfo* timeInfo,
+                           PaStreamCallbackFlags statusFlags)
+{
+    uint64_t durNs = (uint64_t)((double)(endTicks - startTicks) / ticksPerNs);
+    uint64_t perNs = (uint64_t)(1e9 * (double)frames / sampleRate);
+
+    callbacks.fetch_add(1, std::memory_order_relaxed);
+    periodNs.store(perNs, std::memory_order_relaxed);
+    lastDurationNs.store(durNs, std::memory_order_relaxed);
+    atomicMax(maxDurationNs, durNs);
+
+    int bucket = perNs ? (int)(durNs * 10 / perNs) : BUCKETS - 1;
+    if (bucket >= BUCKETS) bucket = BUCKETS - 1;
+    histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+    if (durNs > perNs) overruns.fetch_add(1, std::memory_order_relaxed);
+
+    for (int b = 0; b < FLAG_COUNT; ++b)
+        if (statusFlags & (1ul << b)) flags[b].fetch_add(1, std::memory_order_relaxed);
+
+    // time left between finishing and the buffer reaching the DAC
+    if (timeInfo && timeInfo->outputBufferDacTime > 0.0) {
+        double budgetNs = (timeInfo->outputBufferDacTime - timeInfo->currentTime) * 1e9;
+        atomicMin(minSlackNs, (int64_t)(budgetNs - (double)durNs));
+    }
+}
+
+CallbackStats::Snapshot CallbackStats::snapshot() const {
+    Snapshot s{};
+    s.callbacks = callbacks.load(std::memory_order_relaxed);
+    s.overruns = overruns.load(std::memory_order_relaxed);
+    for (int i = 0; i < BUCKETS; ++i) s.histogram[i] = histogram[i].load(std::memory_order_relaxed);
+    for (int i = 0; i < FLAG_COUNT; ++i) s.flags[i] = flags[i].load(std::memory_order_relaxed);
+    s.maxDurationUs = maxDurationNs.load(std::memory_order_relaxed) * 1e-3;
+    s.lastDurationUs = lastDurationNs.load(std::memory_order_relaxed) * 1e-3;
+    int64_t slack = minSlackNs.load(std::memory_order_relaxed);
+    s.minSlackUs = slack == INT64_MAX ? 0.0 : slack * 1e-3;
+    s.periodUs = periodNs.load(std::memory_order_relaxed) * 1e-3;
+    return s;
+}
+
+const char* CallbackStats::flagName(int bit) {
+    static const char* names[FLAG_COUNT] = {
+        "input underflow", "input overflow", "output underflow", "output overflow", "priming output"
+    };
+    return bit >= 0 && bit < FLAG_COUNT ? names[bit] : "?";
+}
+
+std::string CallbackStats::format(const Snapshot& s) {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(1);
+    os << "callbacks: " << s.callbacks << "  overruns: " << s.overruns
+       << "  period: " << s.periodUs << " us  last: " << s.lastDurationUs
+       << " us  max: " << s.maxDurationUs << " us  min slack: " << s.minSlackUs << " us\n";
+
+    os << "flags:";
+    for (int b = 0; b < FLAG_COUNT; ++b) os << "  " << flagName(b) << "=" << s.flags[b];
+    os << "\n";
+
+    os << "duration / period:\n";
+    for (int i = 0; i < BUCKETS; ++i) {
+        if (!s.histogram[i]) continue;
+        if (i == BUCKETS - 1) os << "   >" << std::setw(3) << (i * 10) << "%";
+        else os << "  " << std::setw(3) << (i * 10) << "-" << std::setw(3) << ((i + 1) * 10) << "%";
+        os << "  " << s.histogram[i] << "\n";
+    }
+    return os.str();
+}
+
+// ---------------- StatsSocket ----------------
+
+#ifndef _WIN32
+
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;                // SO_NOSIGPIPE instead
+#endif
+
+bool StatsSocket::start(const CallbackStats& s, const std::string& p, std::string& error) {
+    stop();
+    stats = &s;
+    path = p;
+
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) { error = "socket path too long"; return false; }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) { error = "socket() failed"; return false; }
+    unlink(path.c_str());
+    if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd, 4) != 0) {
+        error = "cannot listen on " + path + ": " + std::strerror(errno);
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    running = true;
+    thread = std::thread(&StatsSocket::serve, this);
+    return true;
+}
+
+void StatsSocket::stop() {
+    if (!running.exchange(false)) return;
+    thread.join();
+    close(listenFd);
+    listenFd = -1;
+    unlink(path.c_str());
+}
+
+void StatsSocket::serve() {
+    while (running) {
+        pollfd pfd{ listenFd, POLLIN, 0 };
+        if (poll(&pfd, 1, 200) <= 0) continue;
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) continue;
+        // a client gone before the reply must not SIGPIPE the controller
+#ifdef SO_NOSIGPIPE
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof one);
+#endif
+        std::string text = CallbackStats::format(stats->snapshot());
+        const char* p = text.data();
+        size_t left = text.size();
+        while (left > 0) {
+            ssize_t w = send(fd, p, left, SEND_FLAGS);
+            if (w <= 0) break;
+            p += w;
+            left -= (size_t)w;
+        }
+        close(fd);
+    }
+}
+
+#else
+
+bool StatsSocket::start(const CallbackStats&, const std::string&, std::string& error) {
+    error = "stats socket not supported on Windows";
+    return false;
+}
+
+void StatsSocket::stop() {}
+void StatsSocket::serve() {}
+
+#endif
@@ -0,0 +1,95 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <portaudio.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// Cheap timestamp for the audio thread: TSC on x86, the virtual counter on
+// AArch64, steady_clock elsewhere. calibrate() once at startup to convert.
+struct CycleCounter {
+    static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        uint64_t v;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+        return v;
+#else
+        return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+
+    // measures ticks per nanosecond against steady_clock (blocks ~50 ms)
+    static double calibrate();
+};
+
+// Per-callback timing and PortAudio status flags, written by the audio
+// thread with relaxed atomic increments only and read by any other thread.
+class CallbackStats {
+public:
+    // histogram of callback duration as a share of the buffer period
+    static const int BUCKETS = 21;          // 0-10%, 10-20%, ... 190-200%, >200%
+    static const int FLAG_COUNT = 5;        // PaStreamCallbackFlags bits
+
+    struct Snapshot {
+        uint64_t callbacks;
+        uint64_t overruns;                  // callbacks longer than their period
+        uint64_t histogram[BUCKETS];
+        uint64_t flags[FLAG_COUNT];
+        double maxDurationUs;
+        double lastDurationUs;
+        double minSlackUs;                  // tightest gap to the DAC deadline
+        double periodUs;
+    };
+
+    void setTicksPerNs(double t) { ticksPerNs = t; }
+
+    // audio thread
+    void record(uint64_t startTicks, uint64_t endTicks, unsigned long frames, double sampleRate,
+                const PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags statusFlags);
+
+    // any thread
+    Snapshot snapshot() const;
+    static std::string format(const Snapshot& s);
+    static const char* flagName(int bit);
+
+private:
+    double ticksPerNs = 1.0;
+
+    std::atomic<uint64_t> callbacks{0};
+    std::atomic<uint64_t> overruns{0};
+    std::atomic<uint64_t> histogram[BUCKETS] = {};
+    std::atomic<uint64_t> flags[FLAG_COUNT] = {};
+    std::atomic<uint64_t> maxDurationNs{0};
+    std::atomic<uint64_t> lastDurationNs{0};
+    std::atomic<int64_t> minSlackNs{INT64_MAX};
+    std::atomic<uint64_t> periodNs{0};
+};
+
+// Serves CallbackStats::format() to anyone connecting to a local UNIX socket,
+// e.g. `socat - UNIX-CONNECT:/tmp/guitar_controller.sock`. No-op on Windows.
+class StatsSocket {
+public:
+    ~StatsSocket() { stop(); }
+    bool start(const CallbackStats& stats, const std::string& path, std::string& error);
+    void stop();
+
+private:
+    void serve();
+
+    const CallbackStats* stats = nullptr;
+    std::string path;
+    int listenFd = -1;
+    std::atomic<bool> running{false};
+    std::thread thread;
+};
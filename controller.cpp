@@ -1,9 +1,49 @@
+// compile: g++ -std=c++17 -O2 controller.cpp callback_stats.cpp rt_setup.cpp wav_file.cpp effects/*.cpp -lportaudio -pthread -o guitar_controller
+// usage:   guitar_controller [-t threads] [-c channels] [-o mix|route] [-a core] [-n]
+//                            [-r rate] [-b frames] [-q dB|off] [cabinet_ir.wav] [graph]
+//
+// The stream runs at the input device's default sample rate, or -r rate,
+// and every effect is prepared for it; -b sets the buffer size (default
+// 256 frames), e.g. -r 96000 -b 64 for low latency.
+//
+// graph is an EffectGraph spec (effects/effect_graph.h), e.g.
+//   "fuzz@2x > [phaser | vibrato] > pingpong > reverb"
+// and can be replaced while playing with the g key.
+//
+// -t spreads heavy graphs over that many worker threads as a pipeline
+// (effects/pipelined_graph.h), for one more buffer of latency. Light
+// graphs stay on the audio thread.
+//
+// Once a player's input has stayed under -q dBFS (default -80) for longer
+// than every enabled effect's tail, their graph stops running and outputs
+// silence until they play again; -q off keeps it running.
+//
+// -c opens that many input channels, one player each, every one with its
+// own instance of the graph (effects/channel_rack.h); -t then sets how
+// many threads share the channels within each callback. -o mix (default)
+// sums them into one stereo pair, -o route gives each player its own pair
+// of outputs. The c key picks which player the other keys act on.
+//
+// On Linux it locks and prefaults memory at startup and the audio callback
+// moves itself to SCHED_FIFO on one core (the first isolated one, else 0,
+// or -a core), with any worker threads at the same priority (rt_setup.h).
+// Each step reports what permission it lacked and is skipped if it can't
+// be done; -n skips them all.
+//
+// Built with -DRT_SANITIZE -rdynamic, any allocation, lock or blocking
+// call on the audio thread (or a worker on its deadline) aborts with a
+// backtrace (effects/rt_sanitizer.h).
+
 #include <iostream>
+#include <string>
 #include <vector>
-#include <atomic>
+#include <algorithm>
 #include <thread>
 #include <cstring>
+#include <cstdlib>
+#include <cmath>
 #include <chrono>
+#include <atomic>
 #include <portaudio.h>
 
 #ifdef _WIN32
@@ -49,50 +89,324 @@ int _getch() {
 }
 #endif
 
-#include "effects/phaser.h"
 #include "effects/exciter.h"
-#include "effects/reverb.h"
+#include "effects/oversampler.h"
+#include "effects/channel_rack.h"
+#include "effects/denormal.h"
+#include "effects/effect_command.h"
+#include "effects/fast_math.h"
+#include "effects/rt_sanitizer.h"
+#include "effects/spsc_queue.h"
+#include "effects/worker_wait.h"
+#include "callback_stats.h"
+#include "rt_setup.h"
+#include "wav_file.h"
+
+// ------------------ EFFECT GRAPH ----------------------
+// Starts bypassed, toggled node by node with the number keys
+static const char* DEFAULT_GRAPH = "phaser > exciter > cabinet > reverb";
+
+// Racks (a graph per input channel) are built and prepared on the UI
+// thread and handed to the audio thread through gGraphIn, announced by a
+// SWAP_GRAPH command so they stay in order with other commands. The audio
+// thread crossfades to the new rack and hands the old one back through
+// gRetired to be deleted. A rack that arrives mid-fade waits in gQueued
+// until the fade is done; a newer one replaces it unheard.
+static ChannelRack* gGraph = nullptr;        // audio thread only, once running
+static ChannelRack* gIncoming = nullptr;     // fading in, or null
+static ChannelRack* gQueued = nullptr;       // next to fade in, or null
+static int gSwapPos = 0, gSwapLen = 1;
+static SpscQueue<ChannelRack*, 16> gGraphIn, gRetired;
+static int gInChannels = 1, gOutChannels = 2;
+
+// UI thread -> audio thread; the audio thread never locks or allocates
+static SpscQueue<EffectCommand, 256> gCommands;
+
+// Written lock-free by the callback, drained by the UI thread and the socket
+static CallbackStats gStats;
+static double gSampleRate = 48000.0;
+static const char* STATS_SOCKET = "/tmp/guitar_controller.sock";
+
+// Largest block processed in one go; longer callbacks are split
+static const unsigned long MAX_BLOCK = 1024;
+// Stream buffer size, also the period (and added latency) of pipelined graphs
+static unsigned long gFramesPerBuffer = 256;
+
+// Audio thread setup, done by the first callback; gThreadSetup is 1 once
+// it went through, -1 (with gThreadError) if it didn't
+static bool gRealtime = false;               // SCHED_FIFO allowed, wanted
+static int gAudioCore = -1;
+static bool gThreadReady = false;            // audio thread only
+static std::atomic<int> gThreadSetup{0};
+static std::string gThreadError;
 
-// ------------------ EFFECT INSTANCES ------------------
-static Phaser  gPhaser;
-static Exciter gExciter;
-static Reverb  gReverb;
+// ------------------ Audio Callback ---------------------
+static void setupAudioThread() {
+    prefaultStack();
+    bool ok = !gRealtime || makeRealtime(AUDIO_PRIORITY, gAudioCore, gThreadError);
+    gThreadReady = true;
+    gThreadSetup.store(ok ? 1 : -1, std::memory_order_release);
+}
 
-static std::atomic<bool> usePhaser(false);
-static std::atomic<bool> useExciter(false);
-static std::atomic<bool> useReverb(false);
+static void applyCommand(const EffectCommand& c) {
+    if (c.type == EffectCommand::SWAP_GRAPH) {
+        ChannelRack* next;
+        if (!gGraphIn.pop(next)) return;
+        if (gIncoming) {
+            // let the running fade finish, then fade to the newest rack
+            if (gQueued) gRetired.push(gQueued);
+            gQueued = next;
+            return;
+        }
+        gIncoming = next;
+        gSwapPos = 0;
+        return;
+    }
+    // commands go to the newest graph
+    (gQueued ? gQueued : gIncoming ? gIncoming : gGraph)->apply(c);
+}
 
-// ------------------ Audio Callback ---------------------
 static int audioCallback(const void* input, void* output,
                          unsigned long frames,
-                         const PaStreamCallbackTimeInfo*,
-                         PaStreamCallbackFlags,
+                         const PaStreamCallbackTimeInfo* timeInfo,
+                         PaStreamCallbackFlags statusFlags,
                          void*)
 {
+    if (!gThreadReady) setupAudioThread();       // once, before the realtime part
+    ScopedRealtime rt;     // checked in -DRT_SANITIZE builds
+    ScopedFlushDenormals flush;
+    const uint64_t startTicks = CycleCounter::now();
     const float* in  = (const float*)input;
     float* out = (float*)output;
+    const int inCh = gInChannels, outCh = gOutChannels;
 
     if (!in) {
-        memset(out, 0, frames * 2 * sizeof(float));
+        memset(out, 0, frames * outCh * sizeof(float));
+        gStats.record(startTicks, CycleCounter::now(), frames, gSampleRate, timeInfo, statusFlags);
         return paContinue;
     }
 
-    for (unsigned long i = 0; i < frames; ++i) {
-        float x = in[i];
+    // Effects run planar on whole blocks; deinterleave on the way in and
+    // interleave on the way out. The block is split wherever a queued
+    // command is due.
+    static float inBuf[ChannelRack::MAX_CHANNELS][MAX_BLOCK];
+    static float outBuf[2 * ChannelRack::MAX_CHANNELS][MAX_BLOCK];
+    static float newBuf[2 * ChannelRack::MAX_CHANNELS][MAX_BLOCK];
+    const float* inPtr[ChannelRack::MAX_CHANNELS];
+    float* outPtr[2 * ChannelRack::MAX_CHANNELS];
+    float* newPtr[2 * ChannelRack::MAX_CHANNELS];
+    for (int c = 0; c < inCh; ++c) inPtr[c] = inBuf[c];
+    for (int c = 0; c < outCh; ++c) {
+        outPtr[c] = outBuf[c];
+        newPtr[c] = newBuf[c];
+    }
 
-        if (usePhaser)  x = gPhaser.process(x);
-        if (useExciter) x = gExciter.process(x);
-        if (useReverb)  x = gReverb.process(x);
+    unsigned long pos = 0;
+    while (pos < frames) {
+        const EffectCommand* cmd;
+        while ((cmd = gCommands.peek()) &&
+               std::min<unsigned long>(cmd->offset, frames - 1) <= pos) {
+            EffectCommand c;
+            gCommands.pop(c);
+            applyCommand(c);
+        }
 
-        out[2*i + 0] = x;
-        out[2*i + 1] = x;
+        unsigned long end = cmd ? std::min<unsigned long>(cmd->offset, frames - 1) : frames;
+        unsigned long n = std::min(end - pos, MAX_BLOCK);
+        const float* src = in + pos * inCh;
+        for (int c = 0; c < inCh; ++c)
+            for (unsigned long i = 0; i < n; ++i) inBuf[c][i] = src[i * inCh + c];
+
+        gGraph->processBlock(inPtr, outPtr, n);
+
+        if (gIncoming) {
+            // equal-power crossfade from the old rack to the new one
+            gIncoming->processBlock(inPtr, newPtr, n);
+            const float halfPi = 1.57079632679490f;
+            for (unsigned long i = 0; i < n; ++i) {
+                float t = std::min(1.0f, (float)(gSwapPos + (int)i) / (float)gSwapLen);
+                float a = fastSin(halfPi * (1.0f - t)), b = fastSin(halfPi * t);
+                for (int c = 0; c < outCh; ++c) outBuf[c][i] = a * outBuf[c][i] + b * newBuf[c][i];
+            }
+            gSwapPos += (int)n;
+            if (gSwapPos >= gSwapLen) {
+                gRetired.push(gGraph);   // 16 deep and drained every 10 ms
+                gGraph = gIncoming;
+                gIncoming = gQueued;
+                gQueued = nullptr;
+                gSwapPos = 0;
+            }
+        }
+
+        float* o = out + pos * outCh;
+        for (int c = 0; c < outCh; ++c)
+            for (unsigned long i = 0; i < n; ++i) o[i * outCh + c] = outBuf[c][i];
+
+        pos += n;
     }
 
+    gStats.record(startTicks, CycleCounter::now(), frames, gSampleRate, timeInfo, statusFlags);
     return paContinue;
 }
 
+// ------------------ Graph building (UI thread) --------
+struct GraphSetup {
+    int sampleRate = 0;          // the stream's, set once the devices are chosen
+    int threads = 1;             // pipeline workers or channel helpers, 1 = audio thread only
+    int channels = 1;            // players, one input channel each
+    ChannelRack::Output output = ChannelRack::MIX;
+    float silenceDb = EffectGraph::SILENCE_DB;   // idle floor, -INFINITY for never
+    std::vector<float> ir;       // cabinet IR, if one was given
+    int irRate = 0;
+};
+
+// built, given the IR and prepared; null (with a message) on a bad spec
+static ChannelRack* makeGraph(const std::string& spec, const GraphSetup& setup, bool enabled) {
+    ChannelRack* g = new ChannelRack();
+    std::string error;
+    if (!g->build(spec, setup.channels, setup.threads, setup.output, error)) {
+        std::cerr << "Graph: " << error << "\n";
+        delete g;
+        return nullptr;
+    }
+    if (!setup.ir.empty()) g->setImpulse(setup.ir.data(), setup.ir.size(), setup.irRate);
+    g->setSilenceFloor(setup.silenceDb);
+    for (size_t i = 0; i < g->graph().size(); ++i) g->setEnabled(-1, i, enabled);
+    // periods start on callback boundaries: swaps happen at offset 0
+    g->prepare(setup.sampleRate, gFramesPerBuffer, gAudioCore);
+    return g;
+}
+
+static void printGraph(const ChannelRack& rack, int channel, const std::vector<bool>& on) {
+    const PipelinedGraph& g = rack.graph();
+    if (rack.channels() > 1)
+        std::cout << "  player " << (channel + 1) << " of " << rack.channels() << ":\n";
+    for (size_t i = 0; i < g.size(); ++i)
+        std::cout << "  " << (i + 1) << " = " << g.nodeName(i)
+                  << (on[i] ? " [ON]" : " [off]") << "\n";
+    if (g.threaded())
+        std::cout << "  (" << g.stageCount() << " pipeline stages, +"
+                  << gFramesPerBuffer << " samples latency)\n";
+    if (rack.helperCount() > 0)
+        std::cout << "  (" << rack.channels() << " players on " << (rack.helperCount() + 1)
+                  << " threads)\n";
+}
+
+// UI-side state of one player's graph; the audio thread only sees commands
+struct PlayerState {
+    std::vector<bool> nodeOn;
+    float exciterMix = 0.4f;
+    int exciterOversample = 1;
+};
+
+// first node whose name starts with prefix ("exciter" matches "exciter@2x")
+static int findNode(const PipelinedGraph& g, const std::string& prefix) {
+    for (size_t i = 0; i < g.size(); ++i)
+        if (g.nodeName(i).compare(0, prefix.size(), prefix) == 0) return (int)i;
+    return -1;
+}
+
+// ------------------ Realtime setup --------------------
+// memory first, so everything allocated after it is locked in; the audio
+// thread itself is set up by its first callback
+static void startRealtime(int core) {
+    std::string error;
+    if (lockMemory(error)) std::cout << "Memory: locked\n";
+    else std::cout << "Memory not locked: " << error << "\n";
+    prefaultHeap(HEAP_PREFAULT);
+
+    gRealtime = canRealtime(AUDIO_PRIORITY, error);
+    if (!gRealtime) {
+        std::cout << "Audio thread stays on the normal scheduler: " << error << "\n";
+        return;
+    }
+    const int isolated = firstIsolatedCore();
+    gAudioCore = core >= 0 ? core : (isolated >= 0 ? isolated : 0);
+    // same priority, so the callback's yield lets a worker on its core run
+    workerPriority() = AUDIO_PRIORITY;
+    if (isolated < 0)
+        std::cout << "No isolated cores (isolcpus=); the audio thread shares core "
+                  << gAudioCore << " with the OS\n";
+}
+
+static void reportAudioThread() {
+    for (int i = 0; i < 100 && gThreadSetup.load(std::memory_order_acquire) == 0; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const int state = gThreadSetup.load(std::memory_order_acquire);
+    if (state > 0 && gRealtime)
+        std::cout << "Audio thread: SCHED_FIFO " << AUDIO_PRIORITY << " on core " << gAudioCore << "\n";
+    else if (state < 0)
+        std::cout << "Audio thread setup failed: " << gThreadError << "\n";
+}
+
 // ------------------ MAIN -------------------------------
-int main() {
+int main(int argc, char** argv) {
+    GraphSetup setup;
+    bool realtime = true;
+    int audioCore = -1;
+
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if ((a == "-t" || a == "--threads") && i + 1 < argc)
+            setup.threads = std::max(1, std::atoi(argv[++i]));
+        else if ((a == "-c" || a == "--channels") && i + 1 < argc)
+            setup.channels = std::atoi(argv[++i]);
+        else if ((a == "-o" || a == "--output") && i + 1 < argc) {
+            std::string o = argv[++i];
+            if (o != "mix" && o != "route") {
+                std::cerr << "-o takes mix or route\n";
+                return 1;
+            }
+            setup.output = o == "route" ? ChannelRack::ROUTE : ChannelRack::MIX;
+        }
+        else if ((a == "-a" || a == "--audio-core") && i + 1 < argc)
+            audioCore = std::atoi(argv[++i]);
+        else if (a == "-n" || a == "--no-realtime")
+            realtime = false;
+        else if ((a == "-r" || a == "--rate") && i + 1 < argc)
+            setup.sampleRate = std::atoi(argv[++i]);
+        else if ((a == "-b" || a == "--buffer") && i + 1 < argc)
+            gFramesPerBuffer = std::strtoul(argv[++i], nullptr, 10);
+        else if ((a == "-q" || a == "--quiet") && i + 1 < argc) {
+            std::string q = argv[++i];
+            setup.silenceDb = q == "off" ? -INFINITY : (float)std::atof(q.c_str());
+            if (q != "off" && setup.silenceDb >= 0.0f) {
+                std::cerr << "-q takes a level under 0 dBFS, or off\n";
+                return 1;
+            }
+        }
+        else
+            args.push_back(a);
+    }
+    if (setup.channels < 1 || setup.channels > ChannelRack::MAX_CHANNELS) {
+        std::cerr << "-c takes 1 to " << ChannelRack::MAX_CHANNELS << " channels\n";
+        return 1;
+    }
+    if (setup.sampleRate != 0 && setup.sampleRate < 8000) {
+        std::cerr << "-r takes a sample rate of at least 8000\n";
+        return 1;
+    }
+    if (gFramesPerBuffer < 16 || gFramesPerBuffer > 8192) {
+        std::cerr << "-b takes 16 to 8192 frames\n";
+        return 1;
+    }
+    if (audioCore >= (int)std::thread::hardware_concurrency()) {
+        std::cerr << "-a takes a core from 0 to " << std::thread::hardware_concurrency() - 1 << "\n";
+        return 1;
+    }
+    if (realtime) startRealtime(audioCore);
+
+    // cabinet IR is loaded before the stream exists; setImpulse() allocates
+    if (args.size() > 0) {
+        std::string error;
+        if (!readWavMono(args[0], setup.ir, setup.irRate, error)) {
+            std::cerr << error << "\n";
+            return 1;
+        }
+        std::cout << "Cabinet IR: " << args[0] << " (" << setup.ir.size() << " samples)\n";
+    }
+
     Pa_Initialize();
 
     int devCount = Pa_GetDeviceCount();
@@ -115,64 +429,185 @@ int main() {
     std::cout << "\nEnter input device index (default "
               << inputIndex << "): ";
     std::cin >> inputIndex;
+    std::cin.ignore(1024, '\n');
 
     if (inputIndex < 0 || inputIndex >= devCount) {
         std::cerr << "Invalid index.\n";
         return 1;
     }
 
-    // Prepare effects
-    int sampleRate = 48000;
-    gPhaser.prepare(sampleRate);
-    gExciter.prepare(sampleRate);
-    gReverb.prepare(sampleRate);
+    const int outputIndex = Pa_GetDefaultOutputDevice();
+    const int outChannels = setup.output == ChannelRack::ROUTE ? 2 * setup.channels : 2;
+    if (Pa_GetDeviceInfo(inputIndex)->maxInputChannels < setup.channels) {
+        std::cerr << "Input device has " << Pa_GetDeviceInfo(inputIndex)->maxInputChannels
+                  << " channels, " << setup.channels << " requested\n";
+        return 1;
+    }
+    if (outputIndex < 0 || Pa_GetDeviceInfo(outputIndex)->maxOutputChannels < outChannels) {
+        std::cerr << "Output device can't take " << outChannels << " channels\n";
+        return 1;
+    }
 
     // Stream params
     PaStreamParameters inP{}, outP{};
     inP.device = inputIndex;
-    inP.channelCount = 1;
+    inP.channelCount = setup.channels;
     inP.sampleFormat = paFloat32;
     inP.suggestedLatency =
         Pa_GetDeviceInfo(inputIndex)->defaultLowInputLatency;
 
-    outP.device = Pa_GetDefaultOutputDevice();
-    outP.channelCount = 2;
+    outP.device = outputIndex;
+    outP.channelCount = outChannels;
     outP.sampleFormat = paFloat32;
     outP.suggestedLatency =
         Pa_GetDeviceInfo(outP.device)->defaultLowOutputLatency;
 
+    // the device's rate unless -r asked for one; the effects are prepared
+    // for whatever the stream will run at
+    if (setup.sampleRate == 0)
+        setup.sampleRate = (int)Pa_GetDeviceInfo(inputIndex)->defaultSampleRate;
+    PaError formatError = Pa_IsFormatSupported(&inP, &outP, setup.sampleRate);
+    if (formatError != paFormatIsSupported) {
+        std::cerr << "Devices can't run at " << setup.sampleRate << " Hz: "
+                  << Pa_GetErrorText(formatError) << "\n";
+        return 1;
+    }
+    const int sampleRate = setup.sampleRate;
+    std::cout << "Stream: " << sampleRate << " Hz, " << gFramesPerBuffer << " frames ("
+              << 1000.0 * gFramesPerBuffer / sampleRate << " ms)\n";
+
+    // Prepare effects
+    const bool customGraph = args.size() > 1;
+    gGraph = makeGraph(customGraph ? args[1] : DEFAULT_GRAPH, setup, customGraph);
+    if (!gGraph) return 1;
+    gSwapLen = std::max(1, (int)(EffectGraph::FADE_MS * 0.001f * sampleRate));
+    gSampleRate = sampleRate;
+    gInChannels = setup.channels;
+    gOutChannels = outChannels;
+    gStats.setTicksPerNs(CycleCounter::calibrate());
+
+    // UI-side view: the rack last handed over (names only) and each
+    // player's state
+    ChannelRack* uiGraph = gGraph;
+    std::vector<PlayerState> players(setup.channels);
+    for (PlayerState& p : players) p.nodeOn.assign(uiGraph->graph().size(), customGraph);
+    int player = 0;
+
     PaStream* stream;
-    Pa_OpenStream(&stream, &inP, &outP,
-                  sampleRate, 256,
-                  paClipOff, audioCallback, nullptr);
+    PaError openError = Pa_OpenStream(&stream, &inP, &outP,
+                                      sampleRate, gFramesPerBuffer,
+                                      paClipOff, audioCallback, nullptr);
+    if (openError != paNoError) {
+        std::cerr << "Pa_OpenStream failed: " << Pa_GetErrorText(openError) << "\n";
+        return 1;
+    }
 
     Pa_StartStream(stream);
+    reportAudioThread();
+
+    StatsSocket statsSocket;
+    std::string socketError;
+    if (!statsSocket.start(gStats, STATS_SOCKET, socketError))
+        std::cerr << "Stats socket disabled: " << socketError << "\n";
 
     std::cout << "\n--- Guitar Effects Controller ---\n";
     std::cout << "Press:\n"
-              << "  1 = Toggle Phaser\n"
-              << "  2 = Toggle Exciter\n"
-              << "  3 = Toggle Reverb\n"
+              << "  1-9 = Toggle graph node\n"
+              << "  l = List graph nodes\n"
+              << "  c = Next player (with -c)\n"
+              << "  g = Load a new graph, e.g. fuzz > [phaser | vibrato] > pingpong > reverb\n"
+              << "  -/= = Exciter mix down/up\n"
+              << "  o = Exciter oversampling 1x/2x/4x/8x\n"
+              << "  s = Callback timing / xrun stats\n"
               << "  q = Quit\n\n";
+    printGraph(*uiGraph, player, players[player].nodeOn);
+
+    // commands act on the selected player's graph
+    auto send = [&player](EffectCommand cmd) {
+        cmd.channel = player;
+        if (!gCommands.push(cmd))
+            std::cerr << "Command queue full, dropped\n";
+    };
+
+    // xruns are reported as they happen, polled once a second
+    CallbackStats::Snapshot lastStats = gStats.snapshot();
+    auto nextStatsCheck = std::chrono::steady_clock::now();
 
     bool running = true;
     while (running) {
         if (_kbhit()) {
             char c = _getch();
             switch (c) {
-                case '1':
-                    usePhaser = !usePhaser;
-                    std::cout << "Phaser:  " << (usePhaser ? "ON" : "OFF") << "\n";
+                case '1': case '2': case '3': case '4': case '5':
+                case '6': case '7': case '8': case '9': {
+                    size_t i = (size_t)(c - '1');
+                    std::vector<bool>& on = players[player].nodeOn;
+                    if (i >= on.size()) break;
+                    on[i] = !on[i];
+                    send(EffectCommand::enable((int)i, on[i]));
+                    std::cout << uiGraph->graph().nodeName(i) << ": " << (on[i] ? "ON" : "OFF") << "\n";
                     break;
+                }
 
-                case '2':
-                    useExciter = !useExciter;
-                    std::cout << "Exciter: " << (useExciter ? "ON" : "OFF") << "\n";
+                case 'l':
+                    printGraph(*uiGraph, player, players[player].nodeOn);
                     break;
 
-                case '3':
-                    useReverb = !useReverb;
-                    std::cout << "Reverb:  " << (useReverb ? "ON" : "OFF") << "\n";
+                case 'c':
+                    player = (player + 1) % (int)players.size();
+                    printGraph(*uiGraph, player, players[player].nodeOn);
+                    break;
+
+                case 'g': {
+                    std::cout << "graph> " << std::flush;
+                    std::string spec;
+                    if (!std::getline(std::cin, spec) || spec.empty()) break;
+                    ChannelRack* next = makeGraph(spec, setup, true);
+                    if (!next) break;
+                    if (!gGraphIn.push(next)) {
+                        std::cerr << "Graph queue full, dropped\n";
+                        delete next;
+                        break;
+                    }
+                    send(EffectCommand::swapGraph());
+                    uiGraph = next;
+                    for (PlayerState& p : players) {
+                        p.nodeOn.assign(next->graph().size(), true);
+                        p.exciterOversample = 1;
+                    }
+                    printGraph(*uiGraph, player, players[player].nodeOn);
+                    break;
+                }
+
+                case '-':
+                case '=': {
+                    int ex = findNode(uiGraph->graph(), "exciter");
+                    if (ex < 0) { std::cout << "No exciter in the graph\n"; break; }
+                    float& exciterMix = players[player].exciterMix;
+                    exciterMix += (c == '=') ? 0.1f : -0.1f;
+                    exciterMix = std::min(1.0f, std::max(0.0f, exciterMix));
+                    send(EffectCommand::setParam(ex, Exciter::PARAM_MIX, exciterMix));
+                    std::cout << "Exciter mix: " << exciterMix << "\n";
+                    break;
+                }
+
+                case 'o': {
+                    int ex = findNode(uiGraph->graph(), "exciter");
+                    if (ex < 0) { std::cout << "No exciter in the graph\n"; break; }
+                    int& exciterOversample = players[player].exciterOversample;
+                    exciterOversample = exciterOversample == 8 ? 1 : exciterOversample * 2;
+                    send(EffectCommand::setParam(ex, Oversampled<Exciter>::PARAM_FACTOR,
+                                                 (float)exciterOversample));
+                    std::cout << "Exciter oversampling: " << exciterOversample << "x ("
+                              << Oversampled<Exciter>::latencyFor(exciterOversample)
+                              << " samples latency)\n";
+                    break;
+                }
+
+                case 's':
+                    std::cout << CallbackStats::format(gStats.snapshot());
+                    if (uiGraph->graph().threaded())
+                        std::cout << "Pipeline: " << uiGraph->graph().lateBlocks() << " late blocks\n";
                     break;
 
                 case 'q':
@@ -181,11 +616,35 @@ int main() {
             }
         }
 
+        // graphs the audio thread has finished with
+        ChannelRack* old;
+        while (gRetired.pop(old)) delete old;
+
+        if (std::chrono::steady_clock::now() >= nextStatsCheck) {
+            nextStatsCheck += std::chrono::seconds(1);
+            CallbackStats::Snapshot s = gStats.snapshot();
+            for (int b = 0; b < CallbackStats::FLAG_COUNT; ++b)
+                if (s.flags[b] != lastStats.flags[b])
+                    std::cout << "[xrun] " << CallbackStats::flagName(b) << " x"
+                              << (s.flags[b] - lastStats.flags[b]) << "\n";
+            if (s.overruns != lastStats.overruns)
+                std::cout << "[xrun] callback over deadline x" << (s.overruns - lastStats.overruns)
+                          << " (max " << s.maxDurationUs << " us of " << s.periodUs << " us)\n";
+            lastStats = s;
+        }
+
         std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
 
     Pa_StopStream(stream);
     Pa_CloseStream(stream);
     Pa_Terminate();
+
+    ChannelRack* old;
+    while (gRetired.pop(old)) delete old;
+    while (gGraphIn.pop(old)) delete old;
+    delete gQueued;
+    delete gIncoming;
+    delete gGraph;
     return 0;
 }
@@ -0,0 +1,167 @@
+#include "allpass_phaser.h"
+#include "denormal.h"
+#include "fast_math.h"
+#include "tail.h"
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+AllpassPhaser::AllpassPhaser()
+: sampleRate(48000), stages(6), feedback(0.30f), mix(0.60f),
+  minFreq(600.0f), maxFreq(2000.0f), countdown(0)
+{
+    lfo.setRate(0.18f);
+    lfo.setStereoOffset(0.25f);
+    reset();
+}
+
+void AllpassPhaser::prepare(int sr) {
+    sampleRate = sr;
+    lfo.prepare(sr);
+    reset();
+}
+
+void AllpassPhaser::reset() {
+    std::fill(x1, x1 + MAX_STAGES * 2, 0.0f);
+    std::fill(y1, y1 + MAX_STAGES * 2, 0.0f);
+    std::fill(step, step + MAX_STAGES * 2, 0.0f);
+    computeCoeffs(MAX_STAGES, coeff);
+    countdown = 0;
+}
+
+size_t AllpassPhaser::tailSamples() const {
+    // a stage tuned to fc rings with a time constant of sr / (2 pi fc),
+    // longest at the bottom of the sweep; the feedback goes round all of them
+    const float tau = (float)sampleRate / (2.0f * (float)M_PI * minFreq);
+    const float ring = (float)stages * tau * TAIL_DB / 8.6858896f;     // 20 log10(e) dB per tau
+    return (size_t)std::ceil(ring) + feedbackTail(2.0f * tau * (float)stages, feedback);
+}
+
+// first-order all-pass coefficients for both channels at the LFO's phase
+void AllpassPhaser::computeCoeffs(int count, float* out) const {
+    const float nyq = 0.5f * (float)sampleRate;
+    for (int c = 0; c < 2; ++c) {
+        float sweep = 0.5f * (1.0f + lfo.current(c));
+        float fc = minFreq + sweep * (maxFreq - minFreq);
+        for (int s = 0; s < count; ++s) {
+            // stagger each stage slightly to widen the notches
+            float f = std::min(std::max(fc * (1.0f + 0.02f * (float)s), 1.0f), nyq - 10.0f);
+            float t = fastTan((float)M_PI * f / (float)sampleRate);
+            out[s * 2 + c] = (1.0f - t) / (1.0f + t);
+        }
+    }
+}
+
+void AllpassPhaser::process(float in, float& outL, float& outR) {
+    processBlock(&in, &outL, &outR, 1);
+}
+
+void AllpassPhaser::processBlock(const float* in, float* outL, float* outR, size_t n) {
+    switch (stages) {
+        case 2: run<2>(in, outL, outR, n); break;
+        case 3: run<3>(in, outL, outR, n); break;
+        case 4: run<4>(in, outL, outR, n); break;
+        case 5: run<5>(in, outL, outR, n); break;
+        case 6: run<6>(in, outL, outR, n); break;
+        case 7: run<7>(in, outL, outR, n); break;
+        default: run<8>(in, outL, outR, n); break;
+    }
+}
+
+// S stages known at compile time so the whole cascade stays in registers
+template <int S>
+void AllpassPhaser::run(const float* in, float* outL, float* outR, size_t n) {
+    constexpr int L = S * 2;
+    const float fb = feedback, wet = mix, dry = 1.0f - mix;
+
+    float a[L], da[L], px[L], py[L];
+    std::copy(coeff, coeff + L, a);
+    std::copy(step, step + L, da);
+    std::copy(x1, x1 + L, px);
+    std::copy(y1, y1 + L, py);
+
+    while (n > 0) {
+        if (countdown == 0) {
+            // ramp from where we are to the next control point
+            float next[MAX_STAGES * 2];
+            lfo.advance(CONTROL);
+            computeCoeffs(S, next);
+            for (int k = 0; k < L; ++k)
+                da[k] = (next[k] - a[k]) * (1.0f / (float)CONTROL);
+            countdown = CONTROL;
+        }
+
+        const size_t m = std::min(n, countdown);
+        for (size_t i = 0; i < m; ++i) {
+            const float x = in[i];
+            // feedback from each channel's last stage output
+            float v[2] = { x + fb * py[L - 2], x + fb * py[L - 1] };
+            for (int k = 0; k < L; k += 2) {
+                for (int c = 0; c < 2; ++c) {
+                    // y[n] = a * y[n-1] + x[n-1] - a * x[n], grouped so only
+                    // the last multiply-subtract waits on the previous stage
+                    float y = (a[k + c] * py[k + c] + px[k + c]) - a[k + c] * v[c];
+                    px[k + c] = v[c];
+                    py[k + c] = y;
+                    v[c] = y;
+                }
+            }
+            for (int k = 0; k < L; ++k) a[k] += da[k];
+            for (int k = 0; k < L; ++k) {
+                px[k] = flushDenormal(px[k]);
+                py[k] = flushDenormal(py[k]);
+            }
+
+            float l = dry * x + wet * v[0];
+            float r = dry * x + wet * v[1];
+            // gentle soft clip against resonant peaks
+            outL[i] = l / (1.0f + std::fabs(l) * 0.9f);
+            outR[i] = r / (1.0f + std::fabs(r) * 0.9f);
+        }
+
+        countdown -= m;
+        in += m; outL += m; outR += m; n -= m;
+    }
+
+    std::copy(a, a + L, coeff);
+    std::copy(da, da + L, step);
+    std::copy(px, px + L, x1);
+    std::copy(py, py + L, y1);
+}
+
+void AllpassPhaser::setParam(int id, float value) {
+    switch (id) {
+        case PARAM_RATE:
+            lfo.setRate(std::min(10.0f, std::max(0.01f, value)));
+            break;
+        case PARAM_FEEDBACK:
+            feedback = std::min(0.9f, std::max(0.0f, value));
+            break;
+        case PARAM_MIX:
+            mix = std::min(1.0f, std::max(0.0f, value));
+            break;
+        case PARAM_STAGES: {
+            int s = std::min(MAX_STAGES, std::max(2, (int)value));
+            if (s == stages) break;
+            // put every active stage back on the ramp to the control point
+            // the LFO is at; stages coming in have none yet, so they hold
+            // there, and start from silence
+            float next[MAX_STAGES * 2];
+            computeCoeffs(s, next);
+            for (int k = stages * 2; k < s * 2; ++k) {
+                x1[k] = y1[k] = 0.0f;
+                step[k] = 0.0f;
+            }
+            for (int k = 0; k < s * 2; ++k)
+                coeff[k] = next[k] - step[k] * (float)countdown;
+            stages = s;
+            break;
+        }
+        case PARAM_SHAPE:
+            lfo.setShape((Lfo::Shape)std::min(3, std::max(0, (int)std::lround(value))));
+            break;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include "lfo.h"
+
+// Stereo all-pass phaser: a cascade of first-order all-pass stages per
+// channel, swept by one LFO with the right channel a quarter turn ahead.
+//
+// The stage coefficients (one tan() each) are only evaluated every CONTROL
+// samples and ramped linearly in between. State is kept as left/right pairs
+// so both cascades run side by side in the same loop.
+class AllpassPhaser {
+public:
+    static const int MAX_STAGES = 8;
+
+    AllpassPhaser();
+    void prepare(int sampleRate);
+    // process mono input -> stereo output
+    void process(float in, float& outL, float& outR);
+    // block version, planar stereo out; in may alias outL or outR
+    void processBlock(const float* in, float* outL, float* outR, size_t n);
+    void reset();
+
+    // PARAM_SHAPE takes an Lfo::Shape
+    enum Param { PARAM_RATE, PARAM_FEEDBACK, PARAM_MIX, PARAM_STAGES, PARAM_SHAPE };
+    void setParam(int id, float value);
+    // samples it rings for once the input stops (tail.h)
+    size_t tailSamples() const;
+
+private:
+    static constexpr size_t CONTROL = 32;   // samples between coefficient updates
+
+    template <int S> void run(const float* in, float* outL, float* outR, size_t n);
+    void computeCoeffs(int count, float* out) const;
+
+    int sampleRate;
+    int stages;
+    float feedback, mix;
+    float minFreq, maxFreq;
+
+    Lfo lfo;                         // right channel a quarter turn ahead
+    size_t countdown;                // samples left before the next control point
+
+    // [stage * 2 + channel], channel 0 = left, 1 = right
+    float x1[MAX_STAGES * 2], y1[MAX_STAGES * 2];
+    float coeff[MAX_STAGES * 2], step[MAX_STAGES * 2];
+};
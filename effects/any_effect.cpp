@@ -0,0 +1,321 @@
+#include "any_effect.h"
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+#include "allpass_phaser.h"
+#include "autoswell.h"
+#include "bitcrusher.h"
+#include "convolver.h"
+#include "exciter.h"
+#include "fuzz.h"
+#include "oversampler.h"
+#include "phaser.h"
+#include "pingpong_delay.h"
+#include "reverb.h"
+#include "spectral_mirror.h"
+#include "vibrato.h"
+
+void AnyEffect::processBlockStereo(const float* in, float* outL, float* outR, size_t n) {
+    processBlock(in, outL, n);
+    std::copy(outL, outL + n, outR);
+}
+
+static_assert(AnyEffect::PARAM_OVERSAMPLE == (int)Oversampled<Fuzz>::PARAM_FACTOR,
+              "oversampling param ids must match");
+static_assert(AnyEffect::PARAM_DECIMATE == (int)Reverb::PARAM_DECIMATE &&
+              AnyEffect::PARAM_DECIMATE == (int)PingPongDelay::PARAM_DECIMATE,
+              "decimation param ids must match");
+static_assert(AnyEffect::PARAM_ADAA == (int)Fuzz::PARAM_ADAA &&
+              AnyEffect::PARAM_ADAA == (int)Exciter::PARAM_ADAA &&
+              AnyEffect::PARAM_ADAA == (int)Bitcrusher::PARAM_ADAA,
+              "ADAA param ids must match");
+
+namespace {
+
+template <typename E, typename = void>
+struct HasSetParam : std::false_type {};
+template <typename E>
+struct HasSetParam<E, std::void_t<decltype(std::declval<E&>().setParam(0, 0.0f))>>
+    : std::true_type {};
+
+template <typename E, typename = void>
+struct HasSetImpulse : std::false_type {};
+template <typename E>
+struct HasSetImpulse<E, std::void_t<decltype(std::declval<E&>().setImpulse(nullptr, 0, 0))>>
+    : std::true_type {};
+
+template <typename E, typename = void>
+struct IsOversampled : std::false_type {};
+template <typename E>
+struct IsOversampled<E, std::void_t<decltype(E::PARAM_FACTOR)>> : std::true_type {};
+
+// delays its output (resampling filters)
+template <typename E, typename = void>
+struct HasLatency : std::false_type {};
+template <typename E>
+struct HasLatency<E, std::void_t<decltype(std::declval<const E&>().latencySamples())>>
+    : std::true_type {};
+
+// rings on after its input (delays, reverbs, IRs)
+template <typename E, typename = void>
+struct HasTail : std::false_type {};
+template <typename E>
+struct HasTail<E, std::void_t<decltype(std::declval<const E&>().tailSamples())>>
+    : std::true_type {};
+
+template <typename E>
+size_t tailOf(const E& fx) {
+    if constexpr (HasTail<E>::value) return fx.tailSamples();
+    else { (void)fx; return 0; }
+}
+
+// can run at a divided rate (Reverb, PingPongDelay)
+template <typename E, typename = void>
+struct CanDecimate : std::false_type {};
+template <typename E>
+struct CanDecimate<E, std::void_t<decltype(std::declval<E&>().setDecimation(2))>>
+    : std::true_type {};
+
+// buffers can come from a MemoryArena
+template <typename E, typename = void>
+struct UsesArena : std::false_type {};
+template <typename E>
+struct UsesArena<E, std::void_t<decltype(std::declval<const E&>().memoryRequirement(0))>>
+    : std::true_type {};
+
+// can reset without clearing its arena buffers
+template <typename E, typename = void>
+struct HasResetState : std::false_type {};
+template <typename E>
+struct HasResetState<E, std::void_t<decltype(std::declval<E&>().resetState())>>
+    : std::true_type {};
+
+template <typename E>
+void resetStateOf(E& fx) {
+    if constexpr (HasResetState<E>::value) fx.resetState();
+    else fx.reset();
+}
+
+template <typename E>
+size_t memoryOf(const E& fx, int sampleRate) {
+    if constexpr (UsesArena<E>::value) return fx.memoryRequirement(sampleRate);
+    else { (void)fx; (void)sampleRate; return 0; }
+}
+
+template <typename E>
+void prepareWith(E& fx, int sampleRate, MemoryArena* arena) {
+    if constexpr (UsesArena<E>::value) fx.prepare(sampleRate, arena);
+    else { (void)arena; fx.prepare(sampleRate); }
+}
+
+// has a PARAM_ADAA, directly or through Oversampled<>
+template <typename E, typename = void>
+struct HasAdaa : std::false_type {};
+template <typename E>
+struct HasAdaa<E, std::void_t<decltype(E::PARAM_ADAA)>> : std::true_type {};
+template <typename E>
+struct HasAdaa<Oversampled<E>> : HasAdaa<E> {};
+
+template <typename E>
+class MonoEffect : public AnyEffect {
+public:
+    explicit MonoEffect(const char* n) : effectName(n) {}
+
+    const char* name() const override { return effectName; }
+    size_t memoryRequirement(int sampleRate) const override { return memoryOf(fx, sampleRate); }
+    void prepare(int sampleRate, MemoryArena* arena) override { prepareWith(fx, sampleRate, arena); }
+    void reset() override { fx.reset(); }
+    void resetState() override { resetStateOf(fx); }
+
+    void setParam(int id, float value) override {
+        if constexpr (HasSetParam<E>::value) fx.setParam(id, value);
+        else { (void)id; (void)value; }
+    }
+
+    void setImpulse(const float* ir, size_t length, int sampleRate) override {
+        if constexpr (HasSetImpulse<E>::value) fx.setImpulse(ir, length, sampleRate);
+        else { (void)ir; (void)length; (void)sampleRate; }
+    }
+
+    bool oversampled() const override { return IsOversampled<E>::value; }
+    bool antialiased() const override { return HasAdaa<E>::value; }
+    bool decimates() const override { return CanDecimate<E>::value; }
+    float latencySamples() const override {
+        if constexpr (HasLatency<E>::value) return fx.latencySamples();
+        else return 0.0f;
+    }
+    size_t tailSamples() const override { return tailOf(fx); }
+
+    void processBlock(const float* in, float* out, size_t n) override {
+        fx.processBlock(in, out, n);
+    }
+
+    void processEachSample(const float* in, float* outL, float* outR, size_t n) override {
+        for (size_t i = 0; i < n; ++i) outL[i] = outR[i] = fx.process(in[i]);
+    }
+
+private:
+    E fx;
+    const char* effectName;
+};
+
+// mono in, stereo out effects (PingPongDelay, AllpassPhaser)
+template <typename E>
+class StereoEffect : public AnyEffect {
+public:
+    explicit StereoEffect(const char* n) : effectName(n) {}
+
+    const char* name() const override { return effectName; }
+    size_t memoryRequirement(int sampleRate) const override { return memoryOf(fx, sampleRate); }
+    void prepare(int sampleRate, MemoryArena* arena) override { prepareWith(fx, sampleRate, arena); }
+    void reset() override { fx.reset(); }
+    void resetState() override { resetStateOf(fx); }
+    bool stereoOut() const override { return true; }
+    bool decimates() const override { return CanDecimate<E>::value; }
+    size_t tailSamples() const override { return tailOf(fx); }
+
+    void setParam(int id, float value) override {
+        if constexpr (HasSetParam<E>::value) fx.setParam(id, value);
+        else { (void)id; (void)value; }
+    }
+
+    void processBlock(const float* in, float* out, size_t n) override {
+        float r[CHUNK];
+        for (size_t done = 0; done < n; ) {
+            size_t m = std::min(CHUNK, n - done);
+            fx.processBlock(in + done, out + done, r, m);
+            for (size_t i = 0; i < m; ++i) out[done + i] = 0.5f * (out[done + i] + r[i]);
+            done += m;
+        }
+    }
+
+    void processBlockStereo(const float* in, float* outL, float* outR, size_t n) override {
+        fx.processBlock(in, outL, outR, n);
+    }
+
+    void processEachSample(const float* in, float* outL, float* outR, size_t n) override {
+        for (size_t i = 0; i < n; ++i) fx.process(in[i], outL[i], outR[i]);
+    }
+
+private:
+    static constexpr size_t CHUNK = 256;
+    E fx;
+    const char* effectName;
+};
+
+using Factory = std::unique_ptr<AnyEffect> (*)();
+
+template <typename E>
+std::unique_ptr<AnyEffect> makeMono(const char* name) {
+    return std::unique_ptr<AnyEffect>(new MonoEffect<E>(name));
+}
+
+template <typename E>
+std::unique_ptr<AnyEffect> makeStereo(const char* name) {
+    return std::unique_ptr<AnyEffect>(new StereoEffect<E>(name));
+}
+
+// reverb in one of its FDN modes, e.g. "reverb:fdn16"
+template <Reverb::Mode M>
+std::unique_ptr<AnyEffect> makeReverb(const char* name) {
+    std::unique_ptr<AnyEffect> fx = makeMono<Reverb>(name);
+    fx->setParam(Reverb::PARAM_MODE, (float)M);
+    return fx;
+}
+
+struct Entry {
+    const char* name;
+    Factory make;
+    float cost;          // ns/sample, plain (1x, no ADAA)
+};
+
+const Entry REGISTRY[] = {
+    { "allpass",      [] { return makeStereo<AllpassPhaser>("allpass"); },            36.0f },
+    { "autoswell",    [] { return makeMono<AutoSwell>("autoswell"); },                3.0f },
+    { "bitcrusher",   [] { return makeMono<Oversampled<Bitcrusher>>("bitcrusher"); }, 7.0f },
+    { "cabinet",      [] { return makeMono<Convolver>("cabinet"); },                  70.0f },
+    { "exciter",      [] { return makeMono<Oversampled<Exciter>>("exciter"); },       6.0f },
+    { "fuzz",         [] { return makeMono<Oversampled<Fuzz>>("fuzz"); },             4.0f },
+    { "phaser",       [] { return makeMono<Phaser>("phaser"); },                      5.0f },
+    { "pingpong",     [] { return makeStereo<PingPongDelay>("pingpong"); },           8.0f },
+    { "reverb",       [] { return makeMono<Reverb>("reverb"); },                      10.0f },
+    { "reverb:fdn8",  [] { return makeReverb<Reverb::MODE_FDN8>("reverb:fdn8"); },    11.0f },
+    { "reverb:fdn16", [] { return makeReverb<Reverb::MODE_FDN16>("reverb:fdn16"); },  22.0f },
+    { "spectral",     [] { return makeMono<SpectralMirror>("spectral"); },            2.0f },
+    { "vibrato",      [] { return makeMono<Vibrato>("vibrato"); },                    4.0f },
+};
+
+// "fuzz@4x+adaa1" -> registry entry, 4, 1; "reverb@1/2" -> entry, divide 2.
+// null entry for a bad name or suffix
+const Entry* parseName(const std::string& name, int& factor, int& divide, int& adaa) {
+    std::string base = name;
+    adaa = 0;
+    size_t plus = base.find('+');
+    if (plus != std::string::npos) {
+        std::string suffix = base.substr(plus + 1);
+        if (suffix == "adaa1") adaa = 1;
+        else if (suffix == "adaa2") adaa = 2;
+        else return nullptr;
+        base = base.substr(0, plus);
+    }
+
+    factor = divide = 1;
+    size_t at = base.find('@');
+    if (at != std::string::npos) {
+        std::string suffix = base.substr(at + 1);
+        if (suffix == "2x") factor = 2;
+        else if (suffix == "4x") factor = 4;
+        else if (suffix == "8x") factor = 8;
+        else if (suffix == "1/2") divide = 2;
+        else if (suffix == "1/4") divide = 4;
+        else return nullptr;
+        base = base.substr(0, at);
+    }
+
+    for (const Entry& e : REGISTRY)
+        if (base == e.name) return &e;
+    return nullptr;
+}
+
+} // namespace
+
+std::unique_ptr<AnyEffect> AnyEffect::create(const std::string& name) {
+    int factor, divide, adaa;
+    const Entry* e = parseName(name, factor, divide, adaa);
+    if (!e) return nullptr;
+
+    std::unique_ptr<AnyEffect> fx = e->make();
+    if (factor > 1) {
+        if (!fx->oversampled()) return nullptr;
+        fx->setParam(PARAM_OVERSAMPLE, (float)factor);
+    }
+    if (divide > 1) {
+        if (!fx->decimates()) return nullptr;
+        fx->setParam(PARAM_DECIMATE, (float)divide);
+    }
+    if (adaa > 0) {
+        if (!fx->antialiased()) return nullptr;
+        fx->setParam(PARAM_ADAA, (float)adaa);
+    }
+    return fx;
+}
+
+float AnyEffect::cost(const std::string& name) {
+    int factor, divide, adaa;
+    const Entry* e = parseName(name, factor, divide, adaa);
+    if (!e) return 0.0f;
+    // the resampling filters cost about as much as a cheap effect per
+    // extra rate, ADAA about as much again per order
+    if (divide > 1) return e->cost / (float)divide + 6.0f;
+    return e->cost * (float)factor + 6.0f * (float)(factor - 1) + 9.0f * (float)adaa;
+}
+
+const std::vector<std::string>& AnyEffect::names() {
+    static const std::vector<std::string> list = [] {
+        std::vector<std::string> v;
+        for (const Entry& e : REGISTRY) v.push_back(e.name);
+        return v;
+    }();
+    return list;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "memory_arena.h"
+#include "tail.h"
+
+// Runtime handle to any effects/ class, for chains chosen at run time
+// (offline renderer, controller presets). Dispatch is one virtual call per
+// block; the sample loops are the effects' own processBlock().
+//
+// Every effect takes mono input. stereoOut() effects (PingPongDelay,
+// AllpassPhaser) write two planar channels; the rest write the same signal
+// to both when asked for stereo.
+class AnyEffect {
+public:
+    virtual ~AnyEffect() = default;
+
+    // nullptr for an unknown name. Effects that support it take an
+    // oversampling suffix, e.g. "fuzz@4x" (2x, 4x or 8x), and/or an
+    // anti-aliased clipping suffix, "fuzz+adaa1" or "fuzz@2x+adaa2".
+    // Reverb and pingpong take a divided-rate suffix instead, "reverb@1/2"
+    // or "pingpong@1/4", for their wet path. "reverb:fdn8" and
+    // "reverb:fdn16" are the reverb in its FDN modes, suffixes as above.
+    static std::unique_ptr<AnyEffect> create(const std::string& name);
+    static const std::vector<std::string>& names();
+    // rough cost of a name create() accepts, in ns per sample on one desktop
+    // core (benchmark figures, cabinet with a 200 ms IR); 0 if unknown.
+    // Used to decide how to spread a graph over threads.
+    static float cost(const std::string& name);
+
+    virtual const char* name() const = 0;
+    // arena bytes prepare(sampleRate, arena) takes; 0 for effects that
+    // allocate their own buffers, which ignore the arena
+    virtual size_t memoryRequirement(int sampleRate) const { (void)sampleRate; return 0; }
+    virtual void prepare(int sampleRate, MemoryArena* arena = nullptr) = 0;
+    virtual void reset() = 0;
+    // reset() for when the effect's span of the arena has already been
+    // zeroed; skips clearing the buffers where the effect can
+    virtual void resetState() { reset(); }
+    virtual void setParam(int id, float value) { (void)id; (void)value; }
+    // setParam() id for the oversampling factor, same as Oversampled<E>
+    static const int PARAM_OVERSAMPLE = 64;
+    // setParam() id for the ADAA order of Fuzz, Exciter and Bitcrusher
+    static const int PARAM_ADAA = 32;
+    // setParam() id for the wet path's rate divider of Reverb and
+    // PingPongDelay; takes effect at the next prepare()
+    static const int PARAM_DECIMATE = 96;
+    // impulse response for convolution stages, ignored by everything else
+    virtual void setImpulse(const float* ir, size_t length, int sampleRate) {
+        (void)ir; (void)length; (void)sampleRate;
+    }
+
+    virtual bool stereoOut() const { return false; }
+    virtual bool oversampled() const { return false; }
+    virtual bool antialiased() const { return false; }   // takes PARAM_ADAA
+    virtual bool decimates() const { return false; }     // takes PARAM_DECIMATE
+    // delay added by the effect itself (resampling filters), in samples
+    virtual float latencySamples() const { return 0.0f; }
+    // samples the output goes on for once the input has gone quiet, at the
+    // current settings (effects/tail.h); ENDLESS_TAIL if it never settles.
+    // 0 for effects with no delay or feedback, whose filters settle within
+    // EffectGraph::SILENCE_HOLD_MS
+    virtual size_t tailSamples() const { return 0; }
+
+    // mono in, mono out; in and out may alias. stereoOut() effects fold to mono.
+    virtual void processBlock(const float* in, float* out, size_t n) = 0;
+
+    // mono in, planar stereo out; in may alias outL
+    virtual void processBlockStereo(const float* in, float* outL, float* outR, size_t n);
+
+    // processBlockStereo() through the effect's per-sample process(), one
+    // call per sample: the reference the block path must match (benchmark -q)
+    virtual void processEachSample(const float* in, float* outL, float* outR, size_t n) = 0;
+};
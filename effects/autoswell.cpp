@@ -1,9 +1,16 @@
 #include "autoswell.h"
+#include "denormal.h"
 #include <cmath>
+#include <algorithm>
+
+
+// how fast the onset detector forgets a note; a zero crossing inside a note
+// is shorter than this at any rate, so it never counts as a new onset
+constexpr float GATE_RELEASE_SEC = 0.005f;
 
 
 AutoSwell::AutoSwell()
-: attackTimeSec(0.15f), threshold(0.01f), releaseTimeSec(0.2f), env(0.0f), prevAbs(0.0f), sampleRate(48000)
+: attackTimeSec(0.15f), threshold(0.01f), releaseTimeSec(0.2f), env(0.0f), level(0.0f), levelDecay(0.0f), sampleRate(48000)
 { }
 
 
@@ -11,14 +18,15 @@ void AutoSwell::prepare(int sr) {
 sampleRate = sr;
 attackCoeff = 1.0f / (attackTimeSec * sampleRate);
 releaseCoeff = 1.0f / (releaseTimeSec * sampleRate);
+levelDecay = std::exp(-1.0f / (GATE_RELEASE_SEC * sampleRate));
 }
 
 
 float AutoSwell::process(float in) {
 float x = in;
 float ax = fabsf(x);
-if (ax > threshold && prevAbs <= threshold) env = 0.0f;
-prevAbs = ax;
+if (ax > threshold && level <= threshold) env = 0.0f;
+level = flushDenormal(std::max(ax, level * levelDecay));
 if (env < 1.0f) env += attackCoeff; else env = 1.0f;
 if (ax < threshold * 0.5f) env -= releaseCoeff;
 if (env < 0.0f) env = 0.0f;
@@ -27,6 +35,25 @@ return x * env;
 }
 
 
+void AutoSwell::processBlock(const float* in, float* out, size_t n) {
+float e = env, l = level;
+const float thr = threshold, relThr = threshold * 0.5f;
+const float att = attackCoeff, rel = releaseCoeff, decay = levelDecay;
+for (size_t i = 0; i < n; ++i) {
+float x = in[i];
+float ax = fabsf(x);
+if (ax > thr && l <= thr) e = 0.0f;
+l = flushDenormal(std::max(ax, l * decay));
+if (e < 1.0f) e += att; else e = 1.0f;
+if (ax < relThr) e -= rel;
+if (e < 0.0f) e = 0.0f;
+if (e > 1.0f) e = 1.0f;
+out[i] = x * e;
+}
+env = e; level = l;
+}
+
+
 void AutoSwell::reset() {
-env = 0.0f; prevAbs = 0.0f;
+env = 0.0f; level = 0.0f;
 }
\ No newline at end of file
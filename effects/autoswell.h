@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 
 
 class AutoSwell {
@@ -6,13 +7,16 @@ public:
     AutoSwell();
     void prepare(int sampleRate);
     float process(float in);
+    // process n samples; in and out may alias
+    void processBlock(const float* in, float* out, size_t n);
     void reset();
 private:
     float attackTimeSec;
     float threshold;
     float releaseTimeSec;
     float env;
-    float prevAbs;
+    float level;        // peak of |in|, falling over GATE_RELEASE_SEC
+    float levelDecay;
     float attackCoeff;
     float releaseCoeff;
     int sampleRate;
@@ -4,12 +4,15 @@
 
 
 Bitcrusher::Bitcrusher()
-: sampleRate(48000), downsampleFactor(1), bitDepth(8), holdCounter(0), heldSample(0.0f)
-{ }
+: sampleRate(48000), downsampleFactor(1), rateMultiple(1), bitDepth(8), holdCounter(0), heldSample(0.0f)
+{
+    limiter.curve.k = 0.6f;   // same curve as softLimit()
+}
 
 
 void Bitcrusher::prepare(int sr) {
     sampleRate = sr;
+    rateMultiple = std::max(1, (int)std::lround(sr / 48000.0));
 }
 
 
@@ -36,23 +39,74 @@ float Bitcrusher::process(float in) {
     if (bitDepth > 24) bitDepth = 24;
     if (holdCounter <= 0) {
         heldSample = quantizeSample(in, bitDepth);
-        holdCounter = downsampleFactor;
+        holdCounter = downsampleFactor * rateMultiple;
     }
     holdCounter--;
     float wet = heldSample;
     float dry = in;
     float out = 0.6f * dry + 0.9f * wet;
     out *= 0.95f;
-    out = softLimit(out);
+    out = limiter.order() > 0 ? limiter.process(out) : softLimit(out);
     return out;
 }
 
 
+void Bitcrusher::processBlock(const float* in, float* out, size_t n) {
+    if (downsampleFactor < 1) downsampleFactor = 1;
+    if (bitDepth < 1) bitDepth = 1;
+    if (bitDepth > 24) bitDepth = 24;
+    const int factor = downsampleFactor * rateMultiple;
+    const int bits = bitDepth;
+    int counter = holdCounter;
+    float held = heldSample;
+
+    if (limiter.order() > 0) {
+        float y[CHUNK];
+        while (n > 0) {
+            size_t m = std::min(n, CHUNK);
+            for (size_t i = 0; i < m; ++i) {
+                float x = in[i];
+                if (counter <= 0) {
+                    held = quantizeSample(x, bits);
+                    counter = factor;
+                }
+                counter--;
+                y[i] = (0.6f * x + 0.9f * held) * 0.95f;
+            }
+            limiter.processBlock(y, out, m);
+            in += m; out += m; n -= m;
+        }
+        holdCounter = counter;
+        heldSample = held;
+        return;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        float x = in[i];
+        if (counter <= 0) {
+            held = quantizeSample(x, bits);
+            counter = factor;
+        }
+        counter--;
+        float y = (0.6f * x + 0.9f * held) * 0.95f;
+        out[i] = softLimit(y);
+    }
+    holdCounter = counter;
+    heldSample = held;
+}
+
+
 void Bitcrusher::reset() {
     holdCounter = 0;
     heldSample = 0.0f;
+    limiter.reset();
 }
 
 
 void Bitcrusher::setDownsampleFactor(int f) { if (f >= 1) downsampleFactor = f; }
-void Bitcrusher::setBitDepth(int b) { if (b >= 1 && b <= 24) bitDepth = b; }
\ No newline at end of file
+void Bitcrusher::setBitDepth(int b) { if (b >= 1 && b <= 24) bitDepth = b; }
+void Bitcrusher::setParam(int id, float value) {
+    if (id == PARAM_DOWNSAMPLE) setDownsampleFactor((int)std::lround(value));
+    else if (id == PARAM_BIT_DEPTH) setBitDepth((int)std::lround(value));
+    else if (id == PARAM_ADAA) limiter.setOrder((int)std::lround(value));
+}
\ No newline at end of file
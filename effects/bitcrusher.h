@@ -1,4 +1,7 @@
 #pragma once
+#include <cstddef>
+#include "waveshaper.h"
+#include "tail.h"
 
 
 class Bitcrusher {
@@ -6,13 +9,24 @@ public:
     Bitcrusher();
     void prepare(int sampleRate);
     float process(float in);
+    // process n samples; in and out may alias
+    void processBlock(const float* in, float* out, size_t n);
     void reset();
     // simple parameter controls
     void setDownsampleFactor(int f);
     void setBitDepth(int b);
+    // PARAM_ADAA: 0 = plain output limiter, 1/2 = first/second-order
+    // anti-aliased. Fixed id, shared with AnyEffect::PARAM_ADAA.
+    enum Param { PARAM_DOWNSAMPLE, PARAM_BIT_DEPTH, PARAM_ADAA = 32 };
+    void setParam(int id, float value);
+    // quantizing silence leaves a small DC offset, so it never goes quiet
+    size_t tailSamples() const { return ENDLESS_TAIL; }
 private:
+    static constexpr size_t CHUNK = 128;
+    Waveshaper<SoftClip> limiter;
     int sampleRate;
     int downsampleFactor;
+    int rateMultiple;   // hold counts 48 kHz samples, so it scales when oversampled
     int bitDepth;
     int holdCounter;
     float heldSample;
@@ -0,0 +1,173 @@
+#include "channel_rack.h"
+#include <algorithm>
+
+#include "denormal.h"
+#include "rt_sanitizer.h"
+#include "worker_wait.h"
+
+ChannelRack::~ChannelRack() {
+    stop();
+}
+
+// ------------------ Build ------------------------------
+bool ChannelRack::build(const std::string& spec, int channelCount, int threadCount,
+                        Output out, std::string& error) {
+    stop();
+    graphs.clear();
+    if (channelCount < 1 || channelCount > MAX_CHANNELS) {
+        error = "channel count must be 1 to " + std::to_string(MAX_CHANNELS);
+        return false;
+    }
+
+    output = out;
+    threads = std::max(1, threadCount);
+    // one channel pipelines itself; several share the threads between them
+    const int graphThreads = channelCount == 1 ? threads : 1;
+    for (int c = 0; c < channelCount; ++c) {
+        std::unique_ptr<PipelinedGraph> g(new PipelinedGraph());
+        if (!g->build(spec, graphThreads, error)) {
+            graphs.clear();
+            return false;
+        }
+        graphs.push_back(std::move(g));
+    }
+
+    level.assign(channelCount, 1.0f);
+    pan.assign(channelCount, 0.0f);
+    gainL.assign(channelCount, 1.0f);
+    gainR.assign(channelCount, 1.0f);
+    return true;
+}
+
+void ChannelRack::setImpulse(const float* ir, size_t length, int sampleRate) {
+    for (auto& g : graphs) g->setImpulse(ir, length, sampleRate);
+}
+
+void ChannelRack::setSilenceFloor(float db) {
+    for (auto& g : graphs) g->setSilenceFloor(db);
+}
+
+void ChannelRack::setLevel(size_t channel, float value) {
+    if (channel >= graphs.size()) return;
+    level[channel] = std::max(0.0f, value);
+    setPan(channel, pan[channel]);
+}
+
+void ChannelRack::setPan(size_t channel, float value) {
+    if (channel >= graphs.size()) return;
+    pan[channel] = std::min(1.0f, std::max(-1.0f, value));
+    gainL[channel] = level[channel] * std::min(1.0f, 1.0f - pan[channel]);
+    gainR[channel] = level[channel] * std::min(1.0f, 1.0f + pan[channel]);
+}
+
+// ------------------ Setup -----------------------------
+void ChannelRack::prepare(int sampleRate, size_t period, int audioCore) {
+    stop();
+    for (auto& g : graphs) g->prepare(sampleRate, period, audioCore);
+
+    chunk = std::max<size_t>(1, period);
+    chL.assign(graphs.size(), std::vector<float>(chunk, 0.0f));
+    chR.assign(graphs.size(), std::vector<float>(chunk, 0.0f));
+
+    if (graphs.size() < 2) return;
+    // the audio thread's core stays with it; it works too
+    const size_t count = std::min<size_t>(threads, graphs.size()) - 1;
+    const unsigned cores = std::thread::hardware_concurrency();
+    running.store(true);
+    for (size_t h = 0; h < count; ++h) {
+        helpers.emplace_back(&ChannelRack::helperLoop, this);
+        if (cores > 1) pinToCore(helpers.back(), workerCore(h, audioCore, cores));
+        raisePriority(helpers.back());
+    }
+}
+
+void ChannelRack::stop() {
+    running.store(false);
+    for (std::thread& t : helpers) t.join();
+    helpers.clear();
+}
+
+// ------------------ Commands --------------------------
+void ChannelRack::setEnabled(int channel, size_t index, bool on) {
+    EffectCommand cmd = EffectCommand::enable((int)index, on);
+    cmd.channel = channel;
+    apply(cmd);
+}
+
+void ChannelRack::apply(const EffectCommand& cmd) {
+    // between processBlock() calls the helpers touch no graph
+    if (cmd.channel < 0) {
+        for (auto& g : graphs) g->apply(cmd);
+    } else if ((size_t)cmd.channel < graphs.size()) {
+        graphs[cmd.channel]->apply(cmd);
+    }
+}
+
+// ------------------ Processing ------------------------
+void ChannelRack::processBlock(const float* const* in, float* const* out, size_t n) {
+    const size_t count = graphs.size();
+    for (size_t done = 0; done < n; ) {
+        const size_t m = std::min(chunk, n - done);
+
+        if (count == 1) {
+            graphs[0]->processBlock(in[0] + done, chL[0].data(), chR[0].data(), m);
+        } else {
+            taskIn = in;
+            taskOffset = done;
+            taskLen = m;
+            finished.store(0, std::memory_order_relaxed);
+            nextTask.store(0, std::memory_order_release);      // publishes the job
+            generation.fetch_add(1, std::memory_order_release);
+            runChannels();
+            int spins = 0;
+            while (finished.load(std::memory_order_acquire) < (int)count) busyWait(spins);
+        }
+
+        if (output == ROUTE) {
+            for (size_t c = 0; c < count; ++c) {
+                std::copy(chL[c].begin(), chL[c].begin() + m, out[2 * c] + done);
+                std::copy(chR[c].begin(), chR[c].begin() + m, out[2 * c + 1] + done);
+            }
+        } else {
+            float* L = out[0] + done;
+            float* R = out[1] + done;
+            std::fill(L, L + m, 0.0f);
+            std::fill(R, R + m, 0.0f);
+            for (size_t c = 0; c < count; ++c) {
+                const float gl = gainL[c], gr = gainR[c];
+                const float* cl = chL[c].data();
+                const float* cr = chR[c].data();
+                for (size_t i = 0; i < m; ++i) {
+                    L[i] += gl * cl[i];
+                    R[i] += gr * cr[i];
+                }
+            }
+        }
+        done += m;
+    }
+}
+
+void ChannelRack::runChannels() {
+    ScopedRealtime rt;
+    ScopedFlushDenormals flush;
+    const int count = (int)graphs.size();
+    for (int c; (c = nextTask.fetch_add(1, std::memory_order_acq_rel)) < count; ) {
+        graphs[c]->processBlock(taskIn[c] + taskOffset, chL[c].data(), chR[c].data(), taskLen);
+        finished.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void ChannelRack::helperLoop() {
+    uint32_t seen = generation.load(std::memory_order_acquire);
+    int spins = 0;
+    while (running.load(std::memory_order_acquire)) {
+        uint32_t g = generation.load(std::memory_order_acquire);
+        if (g == seen) {
+            idleWait(spins);
+            continue;
+        }
+        seen = g;
+        spins = 0;
+        runChannels();
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "effect_command.h"
+#include "pipelined_graph.h"
+
+// Several players on one multi-channel interface: an independent instance
+// of the same graph per input channel, mixed to one stereo pair or routed
+// to a stereo pair each.
+//
+// With more than one channel, processBlock() runs the channels in parallel
+// inside the call: the calling (audio) thread and threads - 1 helpers each
+// take the next channel nobody has claimed until none are left, so a
+// slow channel never holds up the rest and the call ends when the last
+// channel does, with no added latency. The audio thread only waits on
+// channels already being worked on, so a helper that is late waking up
+// costs nothing. A single channel is a PipelinedGraph built with
+// `threads`, so -t keeps its meaning there.
+//
+// MIX pans each channel (balance law: centre leaves both sides at unity)
+// and sums them. Commands carry the channel whose graph they are for.
+class ChannelRack {
+public:
+    enum Output { MIX, ROUTE };
+    static const int MAX_CHANNELS = 8;
+
+    ChannelRack() = default;
+    ~ChannelRack();
+    ChannelRack(const ChannelRack&) = delete;
+    ChannelRack& operator=(const ChannelRack&) = delete;
+
+    // false and a message for a malformed spec or a bad channel count
+    bool build(const std::string& spec, int channels, int threads, Output output,
+               std::string& error);
+    // impulse response for every cabinet node; before prepare()
+    void setImpulse(const float* ir, size_t length, int sampleRate);
+    // EffectGraph::setSilenceFloor() for every channel; before prepare()
+    void setSilenceFloor(float db);
+    // MIX only; level is linear gain, pan -1 (left) to 1 (right). Before
+    // prepare() or from the audio thread.
+    void setLevel(size_t channel, float level);
+    void setPan(size_t channel, float pan);
+    // allocates and starts the helpers; period and audioCore as for
+    // PipelinedGraph
+    void prepare(int sampleRate, size_t period, int audioCore = 0);
+
+    size_t channels() const { return graphs.size(); }
+    int outputChannels() const { return output == ROUTE ? 2 * (int)graphs.size() : 2; }
+    // every channel runs the same graph
+    const PipelinedGraph& graph() const { return *graphs[0]; }
+
+    void setEnabled(int channel, size_t index, bool on);
+    // to cmd.channel's graph, or all of them for -1
+    void apply(const EffectCommand& cmd);
+
+    float latencySamples() const { return graphs[0]->latencySamples(); }
+    size_t helperCount() const { return helpers.size(); }
+
+    // in: channels() planar inputs, out: outputChannels() planar outputs
+    void processBlock(const float* const* in, float* const* out, size_t n);
+
+private:
+    void runChannels();
+    void helperLoop();
+    void stop();
+
+    std::vector<std::unique_ptr<PipelinedGraph>> graphs;
+    Output output = MIX;
+    int threads = 1;
+    std::vector<float> gainL, gainR;             // MIX, from level and pan
+    std::vector<float> level, pan;
+
+    std::vector<std::vector<float>> chL, chR;    // per channel, chunk frames
+    size_t chunk = 0;
+
+    // current job, published by the store to nextTask
+    const float* const* taskIn = nullptr;
+    size_t taskOffset = 0, taskLen = 0;
+
+    std::vector<std::thread> helpers;
+    std::atomic<bool> running{false};
+    std::atomic<uint32_t> generation{0};         // bumped once per job
+    std::atomic<int> nextTask{0};                // next channel to claim
+    std::atomic<int> finished{0};
+};
@@ -0,0 +1,203 @@
+#include "convolver.h"
+#include <algorithm>
+#include <cmath>
+
+// Going down in rate, the IR goes through a Blackman-windowed sinc lowpass
+// at SINC_CUTOFF of the new Nyquist, SINC_ZEROS zero crossings each side,
+// so what it holds above the new band doesn't fold back into it.
+static const double SINC_CUTOFF = 0.95;
+static const int SINC_ZEROS = 16;
+static const double PI_D = 3.14159265358979323846;
+
+// sample `pos` (in source samples) of src band-limited to cutoff, in
+// cycles per source sample times two
+static float sincAt(const std::vector<float>& src, double pos, double cutoff) {
+    const double width = SINC_ZEROS / cutoff;
+    const long first = std::max(0L, (long)std::ceil(pos - width));
+    const long last = std::min((long)src.size() - 1, (long)std::floor(pos + width));
+    double acc = 0.0;
+    for (long j = first; j <= last; ++j) {
+        const double t = pos - (double)j;
+        const double x = PI_D * cutoff * t;
+        const double sinc = x == 0.0 ? 1.0 : std::sin(x) / x;
+        const double w = 0.42 + 0.5 * std::cos(PI_D * t / width) + 0.08 * std::cos(2.0 * PI_D * t / width);
+        acc += (double)src[j] * cutoff * sinc * w;
+    }
+    return (float)acc;
+}
+
+Convolver::Convolver()
+: sampleRate(48000), mix(1.0f), level(1.0f), sourceRate(0), irLength(0),
+  tailParts(0), bins(0), stride(0), ring(0), fill(0) {}
+
+void Convolver::prepare(int sr) {
+    sampleRate = sr;
+    fft.prepare(2 * PARTITION);
+    bins = fft.bins();
+    stride = (bins + LANES - 1) & ~(LANES - 1);
+    window.assign(2 * PARTITION + LANES, 0.0f);
+    tail.assign(PARTITION, 0.0f);
+    accRe.assign(stride, 0.0f);
+    accIm.assign(stride, 0.0f);
+    scratch.assign(2 * PARTITION, 0.0f);
+    build();
+}
+
+void Convolver::setImpulse(const float* ir, size_t length, int irSampleRate) {
+    source.assign(ir, ir + length);
+    sourceRate = irSampleRate;
+    if (!window.empty()) build();
+}
+
+// resample the source IR to the prepared rate and transform the tail pieces
+void Convolver::build() {
+    std::vector<float> ir;
+    if (source.empty()) {
+        ir.assign(1, 1.0f);
+    } else if (sourceRate <= 0 || sourceRate == sampleRate) {
+        ir = source;
+    } else {
+        double step = (double)sourceRate / (double)sampleRate;
+        size_t len = (size_t)((double)source.size() / step);
+        ir.resize(std::max<size_t>(1, len));
+        if (step > 1.0) {
+            const double cutoff = SINC_CUTOFF / step;
+            for (size_t i = 0; i < ir.size(); ++i) ir[i] = sincAt(source, (double)i * step, cutoff);
+        } else {
+            // going up there's nothing to fold back; linear is enough
+            for (size_t i = 0; i < ir.size(); ++i) {
+                double pos = (double)i * step;
+                size_t j = (size_t)pos;
+                float frac = (float)(pos - (double)j);
+                float a = source[std::min(j, source.size() - 1)];
+                float b = source[std::min(j + 1, source.size() - 1)];
+                ir[i] = a + frac * (b - a);
+            }
+        }
+        // keep the overall gain when the rate changes
+        float g = (float)step;
+        for (float& v : ir) v *= g;
+    }
+    irLength = ir.size();
+
+    head.assign(PARTITION, 0.0f);
+    std::copy(ir.begin(), ir.begin() + std::min(PARTITION, ir.size()), head.begin());
+
+    tailParts = ir.size() > PARTITION ? (ir.size() - 1) / PARTITION : 0;
+    hRe.assign(tailParts * stride, 0.0f);
+    hIm.assign(tailParts * stride, 0.0f);
+    xRe.assign(tailParts * stride, 0.0f);
+    xIm.assign(tailParts * stride, 0.0f);
+
+    // each piece zero-padded to the FFT size
+    for (size_t p = 0; p < tailParts; ++p) {
+        std::fill(scratch.begin(), scratch.end(), 0.0f);
+        size_t start = (p + 1) * PARTITION;
+        size_t len = std::min(PARTITION, ir.size() - start);
+        std::copy(ir.begin() + start, ir.begin() + start + len, scratch.begin());
+        fft.forward(scratch.data(), &hRe[p * stride], &hIm[p * stride]);
+    }
+
+    reset();
+}
+
+void Convolver::reset() {
+    std::fill(window.begin(), window.end(), 0.0f);
+    std::fill(tail.begin(), tail.end(), 0.0f);
+    std::fill(xRe.begin(), xRe.end(), 0.0f);
+    std::fill(xIm.begin(), xIm.end(), 0.0f);
+    ring = 0;
+    fill = 0;
+}
+
+float Convolver::process(float in) {
+    float out;
+    processBlock(&in, &out, 1);
+    return out;
+}
+
+void Convolver::processBlock(const float* in, float* out, size_t n) {
+    if (window.empty()) {
+        if (out != in) std::copy(in, in + n, out);
+        return;
+    }
+
+    const size_t taps = std::min(PARTITION, irLength);
+    const float dry = 1.0f - mix, wet = mix * level;
+    float acc[PARTITION] = {};
+
+    while (n > 0) {
+        const size_t m = std::min(n, PARTITION - fill);
+        float* x = window.data() + PARTITION + fill;
+        std::copy(in, in + m, x);
+
+        // head taps, one tap at a time across the segment so every output
+        // sample is an independent lane; rounded up to whole LANES groups,
+        // which the window's slack and acc's size leave room for
+        std::copy(tail.begin() + fill, tail.begin() + fill + m, acc);
+        const size_t mv = (m + LANES - 1) & ~(LANES - 1);
+        for (size_t k = 0; k < taps; ++k) {
+            const float h = head[k];
+            const float* xk = x - k;
+            for (size_t i = 0; i < mv; i += LANES)
+                for (size_t v = 0; v < LANES; ++v) acc[i + v] += h * xk[i + v];
+        }
+
+        for (size_t i = 0; i < m; ++i) out[i] = x[i] * dry + acc[i] * wet;
+
+        fill += m;
+        if (fill == PARTITION) partitionDone();
+        in += m; out += m; n -= m;
+    }
+}
+
+void Convolver::partitionDone() {
+    if (tailParts > 0) {
+        // spectrum of the last two partitions goes into the delay line
+        fft.forward(window.data(), &xRe[ring * stride], &xIm[ring * stride]);
+
+        // tail for the next partition: newest input against the first tail
+        // piece, the one before against the second, and so on. Bin groups
+        // are outer so the sums stay in registers across all pieces.
+        for (size_t b = 0; b < stride; b += LANES) {
+            float sr[LANES] = {}, si[LANES] = {};
+            size_t slot = ring;
+            for (size_t p = 0; p < tailParts; ++p) {
+                const float* xr = &xRe[slot * stride + b];
+                const float* xi = &xIm[slot * stride + b];
+                const float* hr = &hRe[p * stride + b];
+                const float* hi = &hIm[p * stride + b];
+                for (size_t v = 0; v < LANES; ++v) {
+                    sr[v] += xr[v] * hr[v] - xi[v] * hi[v];
+                    si[v] += xr[v] * hi[v] + xi[v] * hr[v];
+                }
+                slot = slot == 0 ? tailParts - 1 : slot - 1;
+            }
+            std::copy(sr, sr + LANES, &accRe[b]);
+            std::copy(si, si + LANES, &accIm[b]);
+        }
+
+        // overlap-save: the second half of the inverse is valid
+        fft.inverse(accRe.data(), accIm.data(), scratch.data());
+        std::copy(scratch.begin() + PARTITION, scratch.end(), tail.begin());
+        ring = ring + 1 == tailParts ? 0 : ring + 1;
+    }
+
+    std::copy(window.begin() + PARTITION, window.begin() + 2 * PARTITION, window.begin());
+    fill = 0;
+}
+
+void Convolver::setMix(float m) {
+    mix = m < 0.0f ? 0.0f : (m > 1.0f ? 1.0f : m);
+}
+
+void Convolver::setLevel(float l) {
+    level = l < 0.0f ? 0.0f : (l > 4.0f ? 4.0f : l);
+}
+
+void Convolver::setParam(int id, float value) {
+    switch (id) {
+        case PARAM_MIX:   setMix(value); break;
+        case PARAM_LEVEL: setLevel(value); break;
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include "fft.h"
+
+// Zero-latency convolution for cabinet and room impulse responses.
+//
+// The first PARTITION taps run direct-form against the incoming samples, so
+// the dry path adds no delay. The rest of the IR is split into PARTITION-long
+// pieces convolved by overlap-save in the frequency domain: whenever a full
+// partition of input has arrived it is transformed once, pushed into a
+// frequency-domain delay line and multiplied against every tail piece, which
+// yields the tail for the next partition ahead of time. Works at any host
+// block size; the FFT work lands on the blocks that complete a partition.
+//
+// Without an impulse the stage is a unit impulse, i.e. a straight wire.
+class Convolver {
+public:
+    static constexpr size_t PARTITION = 256;
+
+    Convolver();
+    void prepare(int sampleRate);
+    float process(float in);
+    // process n samples; in and out may alias
+    void processBlock(const float* in, float* out, size_t n);
+    void reset();
+
+    // Copies the IR, resampling it if irSampleRate differs from the prepared
+    // rate: down through a windowed-sinc lowpass at the new Nyquist, up
+    // linearly. Allocates, so call it off the audio thread.
+    void setImpulse(const float* ir, size_t length, int irSampleRate);
+    size_t impulseLength() const { return irLength; }
+    // samples it rings for once the input stops: the IR
+    size_t tailSamples() const { return irLength; }
+
+    enum Param { PARAM_MIX, PARAM_LEVEL };
+    void setMix(float m);
+    void setLevel(float l);
+    void setParam(int id, float value);
+
+private:
+    // inner loops run in fixed groups of LANES so they vectorize at -O2
+    static constexpr size_t LANES = 8;
+
+    void build();
+    void partitionDone();
+
+    int sampleRate;
+    float mix, level;
+
+    std::vector<float> source;       // IR as given
+    int sourceRate;
+    size_t irLength;                 // at the prepared rate
+
+    std::vector<float> head;         // first PARTITION taps
+    size_t tailParts;                // tail pieces after the head
+    size_t bins;
+    size_t stride;                   // bins rounded up to LANES, zero padded
+    std::vector<float> hRe, hIm;     // tailParts spectra of stride each
+    std::vector<float> xRe, xIm;     // input spectra ring, same shape
+    size_t ring;                     // slot of the newest input spectrum
+
+    Fft fft;
+    std::vector<float> window;       // previous partition | current partition | slack
+    size_t fill;                     // samples in the current partition
+    std::vector<float> tail;         // tail output for the current partition
+    std::vector<float> accRe, accIm, scratch;
+};
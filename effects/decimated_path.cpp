@@ -0,0 +1,57 @@
+#include "decimated_path.h"
+
+void DecimatedPath::prepare(int factor, int outChannels) {
+    divide = roundFactor(factor);
+    channels = outChannels > 1 ? 2 : 1;
+    // with two stages the first one runs on twice as many samples
+    const int firstTaps = divide == 4 ? SIDE_TAPS_FIRST_OF_TWO : SIDE_TAPS_HALF;
+    down[0].prepare(firstTaps, CHUNK / 2);
+    down[1].prepare(SIDE_TAPS_HALF, CHUNK / 4);
+    for (auto& u : up) {
+        u[0].prepare(firstTaps, CHUNK / 2);
+        u[1].prepare(SIDE_TAPS_HALF, CHUNK / 4);
+    }
+    group.assign(CHUNK, 0.0f);
+    stage.assign(CHUNK, 0.0f);
+    lowIn.assign(CHUNK / 2, 0.0f);
+    for (int c = 0; c < 2; ++c) {
+        lowOut[c].assign(CHUNK / 2, 0.0f);
+        queue[c].assign(CHUNK + MAX_FACTOR, 0.0f);
+    }
+    reset();
+}
+
+void DecimatedPath::reset() {
+    down[0].reset();
+    down[1].reset();
+    for (auto& u : up) { u[0].reset(); u[1].reset(); }
+    for (auto& q : queue) std::fill(q.begin(), q.end(), 0.0f);
+    pending = 0;
+    queued = (size_t)divide - 1;     // the grouping delay, as silence
+}
+
+float DecimatedPath::latencyFor(int factor) {
+    // each stage's filter down and back up, at that stage's upper rate
+    switch (roundFactor(factor)) {
+        case 2: return 2.0f * (2 * SIDE_TAPS_HALF - 1) + 1.0f;
+        case 4: return 2.0f * (2 * SIDE_TAPS_FIRST_OF_TWO - 1)
+                     + 4.0f * (2 * SIDE_TAPS_HALF - 1) + 3.0f;
+        default: return 0.0f;
+    }
+}
+
+void DecimatedPath::interpolate(int c, size_t low) {
+    float* dst = queue[c].data() + queued;
+    if (divide == 2) {
+        up[c][0].upsample(lowOut[c].data(), dst, low);
+    } else {
+        up[c][1].upsample(lowOut[c].data(), stage.data(), low);
+        up[c][0].upsample(stage.data(), dst, 2 * low);
+    }
+}
+
+void DecimatedPath::shift(size_t n) {
+    queued -= n;
+    for (int c = 0; c < channels; ++c)
+        std::copy(queue[c].begin() + n, queue[c].begin() + n + queued, queue[c].begin());
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include "oversampler.h"
+
+// Runs the wet part of an effect at 1/2 or 1/4 of the host rate, between
+// half-band decimation and interpolation filters (the HalfBand stages of
+// Oversampled<>, run the other way round). For effects whose wet signal
+// has little above a quarter of the host rate (reverb tails, lowpassed
+// delay feedback), that's half or a quarter of the work and the delay
+// memory; the dry signal stays at the host rate, with the caller.
+//
+// process() takes any block length: host samples are filtered down in
+// groups of factor(), so the wet output runs factor() - 1 samples behind on
+// top of the filters' own delay, all of it in latencySamples(). Mono in,
+// one or two channels out. At factor 1 there's nothing to divide; callers
+// run their wet path directly.
+class DecimatedPath {
+public:
+    static const int MAX_FACTOR = 4;
+
+    // factor 1, 2 or 4 (others round down to one of those); allocates
+    void prepare(int factor, int channels);
+    void reset();
+    int factor() const { return divide; }
+    // host rate / factor(), what the wet path's state is prepared for
+    static int rateFor(int sampleRate, int factor) { return sampleRate / roundFactor(factor); }
+    static int roundFactor(int f) { return f >= 4 ? 4 : f >= 2 ? 2 : 1; }
+
+    // delay of the wet output behind the input, in host samples
+    float latencySamples() const { return latencyFor(divide); }
+    static float latencyFor(int factor);
+
+    // wet(in, out0, out1, m) processes m samples at the divided rate, out1
+    // null for one channel; its buffers are separate. in may alias out0 or
+    // out1; with out1 and one channel, both get the same.
+    template <typename F>
+    void process(const float* in, float* out0, float* out1, size_t n, F&& wet) {
+        const size_t f = (size_t)divide;
+        while (n > 0) {
+            const size_t take = std::min(n, CHUNK - pending);
+            std::copy(in, in + take, group.data() + pending);
+            pending += take;
+
+            // whole groups go down, through the wet path and back up
+            const size_t whole = pending / f * f;
+            if (whole > 0) {
+                const size_t low = whole / f;
+                const float* src = group.data();
+                if (divide >= 2) { down[0].downsample(src, stage.data(), whole / 2); src = stage.data(); }
+                if (divide == 4) { down[1].downsample(src, lowIn.data(), low); src = lowIn.data(); }
+                if (src != lowIn.data()) std::copy(src, src + low, lowIn.data());
+                wet(lowIn.data(), lowOut[0].data(), channels > 1 ? lowOut[1].data() : nullptr, low);
+                for (int c = 0; c < channels; ++c) interpolate(c, low);
+                queued += whole;
+                std::copy(group.begin() + whole, group.begin() + pending, group.begin());
+                pending -= whole;
+            }
+
+            // queued never drops below take: queued + pending stays factor - 1
+            emit(0, out0, take);
+            if (out1) emit(channels > 1 ? 1 : 0, out1, take);
+            shift(take);
+            in += take; out0 += take; if (out1) out1 += take; n -= take;
+        }
+    }
+
+private:
+    static constexpr size_t CHUNK = 256;            // host samples per pass
+    // the last stage down guards the band the wet path keeps, so it gets
+    // the longer filter; a first stage of two only has to keep its images
+    // out of that band
+    static constexpr int SIDE_TAPS_HALF = 12, SIDE_TAPS_FIRST_OF_TWO = 6;
+
+    void interpolate(int c, size_t low);
+    void emit(int c, float* out, size_t n) const {
+        std::copy(queue[c].begin(), queue[c].begin() + n, out);
+    }
+    void shift(size_t n);
+
+    int divide = 1, channels = 1;
+    size_t pending = 0, queued = 0;
+    HalfBand down[2], up[2][2];                 // up[channel][stage]
+    std::vector<float> group, stage, lowIn;
+    std::vector<float> lowOut[2], queue[2];
+};
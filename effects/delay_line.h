@@ -0,0 +1,158 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+#include "memory_arena.h"
+
+// Interpolation used for fractional reads, fixed at compile time.
+enum class Interp {
+    None,     // truncate to the nearest older sample
+    Linear,
+    Cubic,    // 4-point Catmull-Rom; needs delay >= 1
+    Allpass   // first-order allpass; keeps state, so one read per push
+};
+
+// Circular delay buffer shared by every delay-based effect.
+//
+// Capacity is rounded up to a power of two so wrapping is a mask, never a
+// division or a data-dependent loop. Delays are in samples and counted from
+// the most recently pushed sample: read(0) returns it, read(1) the one
+// before, and so on.
+//
+// The buffer is its own, or a span of a MemoryArena passed to prepare();
+// a copy of an arena-backed line shares the span.
+template <Interp I = Interp::Linear>
+class DelayLine {
+public:
+    DelayLine() = default;
+    DelayLine(const DelayLine& o) { *this = o; }
+    DelayLine& operator=(const DelayLine& o) {
+        own = o.own;
+        buf = o.buf == o.own.data() ? own.data() : o.buf;
+        cap = o.cap; mask = o.mask; writePos = o.writePos; apState = o.apState;
+        return *this;
+    }
+
+    // samples prepare() holds, a power of two
+    static size_t capacityFor(size_t maxDelay, size_t maxBlock = 0) {
+        size_t need = maxDelay + maxBlock + 4;
+        size_t c = 1;
+        while (c < need) c <<= 1;
+        return c;
+    }
+    // arena bytes prepare() takes with an arena
+    static size_t memoryRequirement(size_t maxDelay, size_t maxBlock = 0) {
+        return MemoryArena::bytesFor<float>(capacityFor(maxDelay, maxBlock));
+    }
+
+    // room for maxDelay samples of history plus one block of maxBlock
+    // written ahead of a readBlock(); from the arena if one is given
+    void prepare(size_t maxDelay, size_t maxBlock = 0, MemoryArena* arena = nullptr) {
+        cap = capacityFor(maxDelay, maxBlock);
+        buf = arena ? arena->allocate<float>(cap) : nullptr;
+        if (buf) {
+            std::vector<float>().swap(own);
+        } else {
+            own.assign(cap, 0.0f);
+            buf = own.data();
+        }
+        mask = cap - 1;
+        writePos = 0;
+        apState = 0.0f;
+    }
+
+    void clear() {
+        std::fill(buf, buf + cap, 0.0f);
+        clearState();
+    }
+    // clear() for a buffer someone else has zeroed
+    void clearState() {
+        writePos = 0;
+        apState = 0.0f;
+    }
+
+    size_t capacity() const { return cap; }
+
+    void push(float x) {
+        buf[writePos] = x;
+        writePos = (writePos + 1) & mask;
+    }
+
+    // integer delay, no interpolation
+    float at(size_t delay) const {
+        return buf[(writePos - 1 - delay) & mask];
+    }
+
+    float read(float delay) {
+        return readFrom(writePos, delay);
+    }
+
+    void writeBlock(const float* in, size_t n) {
+        float* b = buf;
+        size_t w = writePos;
+        for (size_t i = 0; i < n; ++i) {
+            b[w] = in[i];
+            w = (w + 1) & mask;
+        }
+        writePos = w;
+    }
+
+    // Reads for the n samples just written with writeBlock(): out[j] is the
+    // signal `delay` samples before the j-th of them.
+    void readBlock(float delay, float* out, size_t n) {
+        size_t end = (writePos - n) & mask;
+        for (size_t j = 0; j < n; ++j) {
+            end = (end + 1) & mask;
+            out[j] = readFrom(end, delay);
+        }
+    }
+
+    // same, with a separate (modulated) delay per sample
+    void readBlock(const float* delays, float* out, size_t n) {
+        size_t end = (writePos - n) & mask;
+        for (size_t j = 0; j < n; ++j) {
+            end = (end + 1) & mask;
+            out[j] = readFrom(end, delays[j]);
+        }
+    }
+
+private:
+    // `end` is the write position just after the sample delays count from
+    float readFrom(size_t end, float delay) {
+        const float* b = buf;
+        int whole = (int)delay;
+        float frac = delay - (float)whole;
+        size_t i0 = (end - 1 - (size_t)whole) & mask;
+
+        if constexpr (I == Interp::None) {
+            return b[i0];
+        } else if constexpr (I == Interp::Linear) {
+            size_t i1 = (i0 - 1) & mask;
+            return b[i0] + frac * (b[i1] - b[i0]);
+        } else if constexpr (I == Interp::Cubic) {
+            float xm1 = b[(i0 + 1) & mask];
+            float x0 = b[i0];
+            float x1 = b[(i0 - 1) & mask];
+            float x2 = b[(i0 - 2) & mask];
+            float c1 = 0.5f * (x1 - xm1);
+            float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+            float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+            return ((c3 * frac + c2) * frac + c1) * frac + x0;
+        } else {
+            // keep the coefficient away from the unstable end at frac -> 0
+            if (frac < 0.1f && whole > 0) { frac += 1.0f; i0 = (i0 + 1) & mask; }
+            float a = (1.0f - frac) / (1.0f + frac);
+            float y = b[(i0 - 1) & mask] + a * (b[i0] - apState);
+            apState = y;
+            return y;
+        }
+    }
+
+    std::vector<float> own;         // unless the buffer is in an arena
+    float* buf = nullptr;
+    size_t cap = 0;
+    size_t mask = 0;
+    size_t writePos = 0;
+    float apState = 0.0f;
+};
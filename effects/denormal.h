@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+
+#if defined(DENORMAL_SOFTWARE)
+// the portable fallback below, e.g. to test it on x86
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define DENORMAL_MXCSR 1
+#elif defined(__aarch64__) && defined(__GNUC__)
+#define DENORMAL_FPCR 1
+#endif
+
+// Every decaying state in the effects (reverb and delay feedback, one-pole
+// filters, envelopes) ends up subnormal, under about 1.2e-38, some seconds
+// after the input stops. On x86 each operation on one takes a microcode
+// assist worth up to ~100 normal ones, so a tail that is long inaudible
+// can still spike the audio thread's CPU.
+//
+// ScopedFlushDenormals sets the calling thread's floating-point unit to
+// treat subnormals as zero, for its lifetime, and puts the previous mode
+// back afterwards: FTZ and DAZ in MXCSR on x86 (SSE), FZ in FPCR on
+// AArch64. The audio callback and the threads working on its deadline
+// hold one around their processing, as do render and benchmark.
+//
+// Where there's neither (or built with -DDENORMAL_SOFTWARE),
+// FLUSH_DENORMALS_IN_HARDWARE is false and ScopedFlushDenormals does
+// nothing; the effects' feedback paths then pass their state through
+// flushDenormal(), which costs an add and a subtract per sample, and only
+// there.
+
+#if defined(DENORMAL_MXCSR) || defined(DENORMAL_FPCR)
+const bool FLUSH_DENORMALS_IN_HARDWARE = true;
+#else
+const bool FLUSH_DENORMALS_IN_HARDWARE = false;
+#endif
+
+class ScopedFlushDenormals {
+public:
+    // on = false switches flushing off for the scope instead
+    explicit ScopedFlushDenormals(bool on = true) {
+#if defined(DENORMAL_MXCSR)
+        old = _mm_getcsr();
+        set(on ? (old | MXCSR_FTZ_DAZ) : (old & ~MXCSR_FTZ_DAZ));
+#elif defined(DENORMAL_FPCR)
+        __asm__ __volatile__("mrs %0, fpcr" : "=r"(old));
+        set(on ? (old | FPCR_FZ) : (old & ~FPCR_FZ));
+#else
+        (void)on;
+#endif
+    }
+    ~ScopedFlushDenormals() {
+#if defined(DENORMAL_MXCSR) || defined(DENORMAL_FPCR)
+        set(old);
+#endif
+    }
+    ScopedFlushDenormals(const ScopedFlushDenormals&) = delete;
+    ScopedFlushDenormals& operator=(const ScopedFlushDenormals&) = delete;
+
+private:
+#if defined(DENORMAL_MXCSR)
+    static const unsigned MXCSR_FTZ_DAZ = 0x8040;       // bit 15 FTZ, bit 6 DAZ
+    static void set(unsigned csr) { _mm_setcsr(csr); }
+    unsigned old;
+#elif defined(DENORMAL_FPCR)
+    static const uint64_t FPCR_FZ = 1ull << 24;
+    static void set(uint64_t fpcr) { __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr)); }
+    uint64_t old;
+#endif
+};
+
+// x, or 0 if it's too small to matter and might be on its way to
+// subnormal; for feedback state where the hardware won't flush it. Adding
+// and taking away DENORMAL_GUARD rounds anything under about 1e-25 away,
+// far below the 24-bit floor, and can't be folded without -ffast-math.
+const float DENORMAL_GUARD = 1e-18f;
+
+inline float flushDenormal(float x) {
+    if (FLUSH_DENORMALS_IN_HARDWARE) return x;
+    return (x + DENORMAL_GUARD) - DENORMAL_GUARD;
+}
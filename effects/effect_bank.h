@@ -0,0 +1,252 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "bitcrusher.h"
+#include "denormal.h"
+#include "exciter.h"
+#include "fast_math.h"
+
+// Structure-of-arrays banks of the small effects: N independent instances
+// (one per channel) whose state lives in arrays and whose per-sample work
+// runs as a loop over the N lanes. The one-pole recursions can't be
+// vectorized across time but can across instances, so a bank of 4, 8 or
+// 16 (an SSE/NEON, AVX or AVX-512 register) costs about what one instance
+// does.
+//
+// Output matches N separate instances with the same settings. Buffers are
+// frame-interleaved, sample i of instance k at [i * N + k], the layout a
+// multi-channel interface delivers; in and out may alias. Plain processing
+// only: the ADAA and oversampled variants stay with the single classes.
+//
+// Each lane loads its inputs before storing anything and the state is
+// copied to locals for the block, so GCC vectorizes the lane loops at -O2
+// without alias checks. Branches are integer-mask selects (fast_math.h).
+
+namespace effect_bank_detail {
+
+const double PI = 3.14159265358979323846;
+
+// one frame of a frame-interleaved buffer into locals
+template <size_t N>
+inline void loadLanes(const float* frame, float (&x)[N]) {
+    for (size_t k = 0; k < N; ++k) x[k] = frame[k];
+}
+
+} // namespace effect_bank_detail
+
+// Fuzz: high-pass, gain, hard clip, low-pass
+template <size_t N>
+class FuzzBank {
+public:
+    FuzzBank() { reset(); }
+
+    void prepare(int sampleRate) {
+        using effect_bank_detail::PI;
+        float x = fastExp((float)(-2.0 * PI * 100.0 / sampleRate));
+        ha = (1.0f + x) * 0.5f;
+        hb = x;
+        x = fastExp((float)(-2.0 * PI * 800.0 / sampleRate));
+        la = 1.0f - x;
+        lb = x;
+    }
+
+    void reset() {
+        std::fill(hz, hz + N, 0.0f);
+        std::fill(lz, lz + N, 0.0f);
+    }
+
+    void processBlock(const float* in, float* out, size_t frames) {
+        float h[N], l[N], x[N];
+        std::copy(hz, hz + N, h);
+        std::copy(lz, lz + N, l);
+        const float a = ha, b = hb, c = la, d = lb, gain = GAIN, clip = CLIP;
+        for (size_t i = 0; i < frames; ++i) {
+            effect_bank_detail::loadLanes(in + i * N, x);
+            float* y = out + i * N;
+            for (size_t k = 0; k < N; ++k) {
+                h[k] = flushDenormal(a * (x[k] - h[k]) + h[k] * b);
+                float v = fast_math_detail::clamp(h[k] * gain, -clip, clip);
+                l[k] = flushDenormal(c * v + d * l[k]);
+                y[k] = l[k];
+            }
+        }
+        std::copy(h, h + N, hz);
+        std::copy(l, l + N, lz);
+    }
+
+private:
+    static constexpr float GAIN = 80.0f, CLIP = 0.08f;    // as Fuzz
+    float hz[N], lz[N];
+    float ha = 0.0f, hb = 0.0f, la = 0.0f, lb = 0.0f;
+};
+
+// Exciter: high-passed signal through tanh, mixed with the dry one
+template <size_t N>
+class ExciterBank {
+public:
+    ExciterBank() {
+        reset();
+        for (size_t k = 0; k < N; ++k) setMix(k, 0.4f);
+    }
+
+    void prepare(int sampleRate) {
+        using effect_bank_detail::PI;
+        coeff = fastExp((float)(-2.0 * PI * 3000.0 / sampleRate));
+    }
+
+    void reset() { std::fill(state, state + N, 0.0f); }
+
+    void setMix(size_t lane, float m) {
+        if (lane >= N) return;
+        m = m < 0.0f ? 0.0f : (m > 1.0f ? 1.0f : m);
+        wet[lane] = m;
+        dry[lane] = 1.0f - m;
+    }
+
+    // Exciter::PARAM_MIX
+    void setParam(size_t lane, int id, float value) {
+        if (id == Exciter::PARAM_MIX) setMix(lane, value);
+    }
+
+    void processBlock(const float* in, float* out, size_t frames) {
+        float z[N], x[N];
+        std::copy(state, state + N, z);
+        const float a = coeff, b = 1.0f - coeff;
+        for (size_t i = 0; i < frames; ++i) {
+            effect_bank_detail::loadLanes(in + i * N, x);
+            float* y = out + i * N;
+            for (size_t k = 0; k < N; ++k) {
+                float hp = x[k] - z[k];
+                z[k] = flushDenormal(z[k] * a + x[k] * b);
+                y[k] = x[k] * dry[k] + fastTanh(hp * 4.0f) * wet[k];
+            }
+        }
+        std::copy(z, z + N, state);
+    }
+
+private:
+    float state[N];
+    float dry[N], wet[N];
+    float coeff = 0.0f;
+};
+
+// AutoSwell: envelope restarted on each note onset, ramps up, falls in silence
+template <size_t N>
+class AutoSwellBank {
+public:
+    AutoSwellBank() { reset(); }
+
+    void prepare(int sampleRate) {
+        attack = 1.0f / (ATTACK_SEC * sampleRate);
+        release = 1.0f / (RELEASE_SEC * sampleRate);
+        levelDecay = std::exp(-1.0f / (GATE_RELEASE_SEC * sampleRate));
+    }
+
+    void reset() {
+        std::fill(env, env + N, 0.0f);
+        std::fill(level, level + N, 0.0f);
+    }
+
+    void processBlock(const float* in, float* out, size_t frames) {
+        using fast_math_detail::clamp;
+        using fast_math_detail::select;
+        float e[N], l[N], x[N];
+        std::copy(env, env + N, e);
+        std::copy(level, level + N, l);
+        const float thr = THRESHOLD, relThr = THRESHOLD * 0.5f;
+        const float att = attack, rel = release, decay = levelDecay;
+        for (size_t i = 0; i < frames; ++i) {
+            effect_bank_detail::loadLanes(in + i * N, x);
+            float* y = out + i * N;
+            for (size_t k = 0; k < N; ++k) {
+                float ax = std::fabs(x[k]);
+                float v = select((ax > thr) & (l[k] <= thr), 0.0f, e[k]);
+                float held = l[k] * decay;
+                l[k] = flushDenormal(select(ax > held, ax, held));
+                v = select(v < 1.0f, v + att, 1.0f);
+                v -= select(ax < relThr, rel, 0.0f);
+                v = clamp(v, 0.0f, 1.0f);
+                e[k] = v;
+                y[k] = x[k] * v;
+            }
+        }
+        std::copy(e, e + N, env);
+        std::copy(l, l + N, level);
+    }
+
+private:
+    static constexpr float ATTACK_SEC = 0.15f, RELEASE_SEC = 0.2f;   // as AutoSwell
+    static constexpr float THRESHOLD = 0.01f, GATE_RELEASE_SEC = 0.005f;
+    float env[N], level[N];
+    float attack = 0.0f, release = 0.0f, levelDecay = 0.0f;
+};
+
+// Bitcrusher: sample-and-hold downsampling and bit reduction, blended with
+// the dry signal into the soft limiter. Each lane has its own settings.
+template <size_t N>
+class BitcrusherBank {
+public:
+    BitcrusherBank() {
+        reset();
+        for (size_t k = 0; k < N; ++k) {
+            downsample[k] = 1;
+            setBitDepth(k, 8);
+        }
+    }
+
+    void prepare(int sampleRate) {
+        rateMultiple = std::max(1, (int)std::lround(sampleRate / 48000.0));
+    }
+
+    void reset() {
+        std::fill(counter, counter + N, 0);
+        std::fill(held, held + N, 0.0f);
+    }
+
+    void setDownsampleFactor(size_t lane, int f) { if (lane < N && f >= 1) downsample[lane] = f; }
+    void setBitDepth(size_t lane, int b) {
+        if (lane < N && b >= 1 && b <= 24) levels[lane] = (float)((1 << b) - 1);
+    }
+
+    // Bitcrusher::PARAM_DOWNSAMPLE, PARAM_BIT_DEPTH
+    void setParam(size_t lane, int id, float value) {
+        if (id == Bitcrusher::PARAM_DOWNSAMPLE) setDownsampleFactor(lane, (int)std::lround(value));
+        else if (id == Bitcrusher::PARAM_BIT_DEPTH) setBitDepth(lane, (int)std::lround(value));
+    }
+
+    void processBlock(const float* in, float* out, size_t frames) {
+        using fast_math_detail::clamp;
+        using fast_math_detail::select;
+        int count[N], period[N];
+        float h[N], x[N];
+        std::copy(counter, counter + N, count);
+        std::copy(held, held + N, h);
+        for (size_t k = 0; k < N; ++k) period[k] = downsample[k] * rateMultiple;
+
+        for (size_t i = 0; i < frames; ++i) {
+            effect_bank_detail::loadLanes(in + i * N, x);
+            float* y = out + i * N;
+            for (size_t k = 0; k < N; ++k) {
+                // quantized every sample, kept when the hold runs out; v >= 0,
+                // so truncation is Bitcrusher's floor(v + 0.5)
+                float c = clamp(x[k], -1.0f, 1.0f);
+                float v = (c + 1.0f) * 0.5f;
+                float q = (float)(int)(v * levels[k] + 0.5f) / levels[k] * 2.0f - 1.0f;
+                int take = -(int)(count[k] <= 0);
+                h[k] = select(take, q, h[k]);
+                count[k] = ((period[k] & take) | (count[k] & ~take)) - 1;
+                float s = (0.6f * x[k] + 0.9f * h[k]) * 0.95f;
+                y[k] = s / (1.0f + std::fabs(s) * 0.6f);
+            }
+        }
+        std::copy(count, count + N, counter);
+        std::copy(h, h + N, held);
+    }
+
+private:
+    int counter[N], downsample[N];
+    float held[N], levels[N];
+    int rateMultiple = 1;
+};
@@ -0,0 +1,277 @@
+#pragma once
+#include <array>
+#include <tuple>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "effect_command.h"
+#include "memory_arena.h"
+
+// Fixed chain of mono effects known at build time, for rigs that don't need
+// EffectGraph's runtime specs, parallel branches or stereo buses.
+//
+// Which effects are enabled is kept as a bit mask (bit I = I-th type) and
+// sampled once per block. One kernel is instantiated for every possible mask,
+// so the steady-state work is a single indirect call followed by a straight
+// sequence of processBlock() calls: no enable checks or atomic loads run
+// inside any sample loop.
+//
+// Enabling or bypassing an effect doesn't switch instantly: the effect's
+// output is equal-power crossfaded against its input over FADE_MS. Only
+// blocks that contain a fade take the slower per-effect path.
+//
+// As in EffectGraph, an effect that has faded out is cleared CLEAR_BYTES
+// of its arena span per block and then given resetState(), so switching
+// it back on doesn't zero a reverb's delay lines inside one callback.
+//
+// setEnabled()/setParam()/apply() must be called from the audio thread,
+// normally with commands popped from an SpscQueue.
+template <typename... Ts>
+class EffectChain {
+public:
+    static constexpr size_t SIZE = sizeof...(Ts);
+    static_assert(SIZE > 0, "EffectChain needs at least one effect");
+    static_assert(SIZE <= 8, "EffectChain generates 2^N kernels; keep N small");
+
+    using Mask = unsigned;
+    static constexpr Mask ALL = (1u << SIZE) - 1u;
+    static constexpr float FADE_MS = 10.0f;
+    static constexpr size_t CLEAR_BYTES = 256 * 1024;   // per block
+
+    void prepare(int sampleRate) {
+        size_t bytes = 0;
+        std::apply([&](auto&... e) { ((bytes += memoryOf(e, sampleRate)), ...); }, effects);
+        // effects fall back to their own buffers if this fails
+        if (!arena.reserve(bytes)) arena.reserve(0);
+        prepareAll(sampleRate, std::index_sequence_for<Ts...>{});
+
+        fadeLen = std::max(1, (int)(FADE_MS * 0.001f * sampleRate));
+        fadeTable.resize(fadeLen + 1);
+        for (int k = 0; k <= fadeLen; ++k)
+            fadeTable[k] = std::sin(0.5f * PI * (float)k / (float)fadeLen);
+
+        for (size_t i = 0; i < SIZE; ++i)
+            fadePos[i] = (target >> i) & 1u ? fadeLen : 0;
+        fading = 0;
+        stale = 0;
+    }
+
+    void reset() {
+        std::apply([](auto&... e) { (e.reset(), ...); }, effects);
+        stale = 0;
+    }
+
+    template <size_t I>
+    auto& get() { return std::get<I>(effects); }
+
+    Mask enabledMask() const { return target; }
+
+    void setEnabled(size_t index, bool on) {
+        if (index >= SIZE) return;
+        Mask bit = 1u << index;
+        if (on == ((target & bit) != 0)) return;
+        // don't resume a stale tail; normally cleared already, else finish now
+        if (on && (stale & bit)) clearAt(index, SIZE_MAX);
+        target = on ? (target | bit) : (target & ~bit);
+        if (fadeTable.empty()) fadePos[index] = on ? fadeLen : 0; // not prepared yet
+        else fading |= bit;
+    }
+
+    // forwards to Effect::setParam(int, float) on effects that have one
+    void setParam(size_t index, int param, float value) {
+        setParamAt(index, param, value, std::index_sequence_for<Ts...>{});
+    }
+
+    void apply(const EffectCommand& cmd) {
+        if (cmd.effect < 0) return;
+        if (cmd.type == EffectCommand::SET_ENABLED)
+            setEnabled((size_t)cmd.effect, cmd.value != 0.0f);
+        else
+            setParam((size_t)cmd.effect, cmd.param, cmd.value);
+    }
+
+    // in and out may alias
+    void processBlock(const float* in, float* out, size_t n) {
+        if (stale) clearStale();
+        if (fading == 0) {
+            KERNELS[target](*this, in, out, n);
+            return;
+        }
+        if (out != in) std::copy(in, in + n, out);
+        fadeBlock(out, n, std::index_sequence_for<Ts...>{});
+    }
+
+private:
+    static constexpr float PI = 3.14159265358979323846f;
+    static constexpr size_t CHUNK = 256;
+
+    using Kernel = void (*)(EffectChain&, const float*, float*, size_t);
+
+    // ---- steady state: one kernel per mask ----
+
+    template <Mask M, size_t I>
+    void stage(const float*& src, float* out, size_t n) {
+        if constexpr (((M >> I) & 1u) != 0) {
+            std::get<I>(effects).processBlock(src, out, n);
+            src = out;
+        }
+    }
+
+    template <Mask M, size_t... I>
+    void run(const float* in, float* out, size_t n, std::index_sequence<I...>) {
+        const float* src = in;
+        (stage<M, I>(src, out, n), ...);
+        if (src != out) std::copy(src, src + n, out);
+    }
+
+    template <Mask M>
+    static void kernel(EffectChain& c, const float* in, float* out, size_t n) {
+        c.run<M>(in, out, n, std::index_sequence_for<Ts...>{});
+    }
+
+    template <size_t... M>
+    static constexpr auto makeKernels(std::index_sequence<M...>) {
+        return std::array<Kernel, sizeof...(M)>{ &kernel<(Mask)M>... };
+    }
+
+    static constexpr std::array<Kernel, (1u << SIZE)> KERNELS =
+        makeKernels(std::make_index_sequence<(1u << SIZE)>{});
+
+    // ---- transition: at least one effect is fading ----
+
+    template <size_t I>
+    void fadeStage(float* buf, size_t n) {
+        constexpr Mask bit = 1u << I;
+        auto& fx = std::get<I>(effects);
+        if (!(fading & bit)) {
+            if (target & bit) fx.processBlock(buf, buf, n);
+            return;
+        }
+
+        int pos = fadePos[I];
+        const int step = (target & bit) ? 1 : -1;
+
+        const float* g = fadeTable.data();
+        float wet[CHUNK];
+        for (size_t done = 0; done < n; ) {
+            size_t m = std::min(CHUNK, n - done);
+            float* x = buf + done;
+            fx.processBlock(x, wet, m);
+            for (size_t i = 0; i < m; ++i) {
+                x[i] = g[fadeLen - pos] * x[i] + g[pos] * wet[i];
+                pos += step;
+                pos = pos < 0 ? 0 : (pos > fadeLen ? fadeLen : pos);
+            }
+            done += m;
+        }
+        fadePos[I] = pos;
+        if (pos == (step > 0 ? fadeLen : 0)) fading &= ~bit;
+        if (pos == 0) {
+            stale |= bit;
+            cleared[I] = 0;
+        }
+    }
+
+    template <size_t... I>
+    void fadeBlock(float* buf, size_t n, std::index_sequence<I...>) {
+        (fadeStage<I>(buf, n), ...);
+    }
+
+    // ---- per-index dispatch for commands ----
+
+    template <typename E, typename = void>
+    struct HasSetParam : std::false_type {};
+    template <typename E>
+    struct HasSetParam<E, std::void_t<decltype(std::declval<E&>().setParam(0, 0.0f))>>
+        : std::true_type {};
+
+    template <size_t... I>
+    void setParamAt(size_t index, int param, float value, std::index_sequence<I...>) {
+        auto one = [&](auto& fx, size_t i) {
+            if constexpr (HasSetParam<std::decay_t<decltype(fx)>>::value)
+                if (i == index) fx.setParam(param, value);
+        };
+        (one(std::get<I>(effects), I), ...);
+    }
+
+    // ---- arena spans and clearing faded-out effects ----
+
+    template <typename E, typename = void>
+    struct UsesArena : std::false_type {};
+    template <typename E>
+    struct UsesArena<E, std::void_t<decltype(std::declval<const E&>().memoryRequirement(0))>>
+        : std::true_type {};
+
+    template <typename E, typename = void>
+    struct HasResetState : std::false_type {};
+    template <typename E>
+    struct HasResetState<E, std::void_t<decltype(std::declval<E&>().resetState())>>
+        : std::true_type {};
+
+    template <typename E>
+    static size_t memoryOf(const E& fx, int sampleRate) {
+        if constexpr (UsesArena<E>::value) return fx.memoryRequirement(sampleRate);
+        else { (void)fx; (void)sampleRate; return 0; }
+    }
+
+    template <size_t... I>
+    void prepareAll(int sampleRate, std::index_sequence<I...>) {
+        auto one = [&](auto& fx, size_t i) {
+            spanFrom[i] = arena.bytesUsed();
+            if constexpr (UsesArena<std::decay_t<decltype(fx)>>::value) fx.prepare(sampleRate, &arena);
+            else fx.prepare(sampleRate);
+            spanBytes[i] = arena.bytesUsed() - spanFrom[i];
+            ownBuffers[i] = spanBytes[i] < memoryOf(fx, sampleRate);
+        };
+        (one(std::get<I>(effects), I), ...);
+    }
+
+    // resetState() where the effect has one and its buffers are all in
+    // the (zeroed) span, else reset()
+    template <size_t... I>
+    void resetAt(size_t index, std::index_sequence<I...>) {
+        auto one = [&](auto& fx, size_t i) {
+            if (i != index) return;
+            if constexpr (HasResetState<std::decay_t<decltype(fx)>>::value)
+                if (!ownBuffers[i]) { fx.resetState(); return; }
+            fx.reset();
+        };
+        (one(std::get<I>(effects), I), ...);
+    }
+
+    // zeroes up to `budget` bytes of a stale effect's span, resets it once done
+    size_t clearAt(size_t index, size_t budget) {
+        const size_t k = std::min(budget, spanBytes[index] - cleared[index]);
+        arena.clear(spanFrom[index] + cleared[index], k);
+        cleared[index] += k;
+        if (cleared[index] == spanBytes[index]) {
+            resetAt(index, std::index_sequence_for<Ts...>{});
+            stale &= ~(1u << index);
+        }
+        return k;
+    }
+
+    void clearStale() {
+        size_t budget = CLEAR_BYTES;
+        for (size_t i = 0; i < SIZE && budget > 0; ++i)
+            if ((stale >> i) & 1u) budget -= clearAt(i, budget);
+    }
+
+    std::tuple<Ts...> effects;
+    MemoryArena arena;                 // the effects' delay lines
+
+    Mask target = 0;   // effects that are (or are fading) on
+    Mask fading = 0;   // effects mid-crossfade
+    int fadeLen = 1;
+    std::array<int, SIZE> fadePos{};   // 0 = bypassed, fadeLen = fully on
+    std::vector<float> fadeTable;      // sin quarter-wave, fadeLen + 1 entries
+
+    Mask stale = 0;                    // faded out, not yet cleared
+    std::array<size_t, SIZE> spanFrom{}, spanBytes{}, cleared{};   // arena bytes
+    std::array<bool, SIZE> ownBuffers{};   // some of theirs aren't in the span
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+// Message sent from the UI thread to the audio thread.
+//
+// offset is the frame within the next processed block at which the command
+// takes effect; offsets past the end of the block apply at its last frame.
+struct EffectCommand {
+    // SWAP_GRAPH: take the next graph handed over alongside the queue
+    // (controller.cpp); effect, param and value are unused
+    enum Type { SET_ENABLED, SET_PARAM, SWAP_GRAPH };
+
+    Type type;
+    int effect;      // index of the effect in its chain
+    int param;       // SET_PARAM only: effect-specific parameter id
+    float value;     // SET_ENABLED: 0 = bypass, otherwise on
+    unsigned offset;
+    int channel;     // ChannelRack: whose graph, -1 = every channel's
+
+    static EffectCommand enable(int effect, bool on, unsigned offset = 0) {
+        return { SET_ENABLED, effect, 0, on ? 1.0f : 0.0f, offset, -1 };
+    }
+
+    static EffectCommand setParam(int effect, int param, float value, unsigned offset = 0) {
+        return { SET_PARAM, effect, param, value, offset, -1 };
+    }
+
+    static EffectCommand swapGraph(unsigned offset = 0) {
+        return { SWAP_GRAPH, -1, 0, 0.0f, offset, -1 };
+    }
+};
@@ -0,0 +1,434 @@
+#include "effect_graph.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+static const float PI = 3.14159265358979323846f;
+
+static void skipSpace(const std::string& s, size_t& pos) {
+    while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t')) ++pos;
+}
+
+// ------------------ Compile ---------------------------
+bool EffectGraph::build(const std::string& spec, std::string& error, bool stereoIn) {
+    nodes.clear();
+    ops.clear();
+    busStereo.clear();
+    buses.clear();
+    fadeTable.clear();
+    maxBlock = 0;
+
+    size_t pos = 0;
+    inputStereo = stereoIn;
+    int root = newBus(stereoIn);
+    bool ok = compileChain(spec, pos, root, error);
+    skipSpace(spec, pos);
+    if (ok && pos < spec.size()) {
+        error = "unexpected '" + std::string(1, spec[pos]) + "' at position " + std::to_string(pos);
+        ok = false;
+    }
+    if (ok && nodes.empty()) {
+        error = "empty effect graph";
+        ok = false;
+    }
+    if (!ok) {
+        nodes.clear();
+        ops.clear();
+        busStereo.clear();
+    }
+    busTail.assign(busStereo.size(), 0);
+    tailDirty = true;
+    return ok;
+}
+
+int EffectGraph::newBus(bool stereo) {
+    busStereo.push_back(stereo);
+    return (int)busStereo.size() - 1;
+}
+
+bool EffectGraph::compileChain(const std::string& s, size_t& pos, int bus, std::string& error) {
+    while (true) {
+        if (!compileItem(s, pos, bus, error)) return false;
+        skipSpace(s, pos);
+        if (pos < s.size() && s[pos] == '>') { ++pos; continue; }
+        return true;
+    }
+}
+
+bool EffectGraph::compileItem(const std::string& s, size_t& pos, int bus, std::string& error) {
+    skipSpace(s, pos);
+
+    if (pos < s.size() && s[pos] == '[') {
+        // each branch works on its own copy of the input bus
+        ++pos;
+        std::vector<int> branches;
+        while (true) {
+            const bool stereo = busStereo[bus];
+            int b = newBus(stereo);
+            ops.push_back({ Op::COPY, -1, bus, b, stereo, 1.0f });
+            if (!compileChain(s, pos, b, error)) return false;
+            branches.push_back(b);
+            skipSpace(s, pos);
+            if (pos < s.size() && s[pos] == '|') { ++pos; continue; }
+            if (pos < s.size() && s[pos] == ']') { ++pos; break; }
+            error = "expected '|' or ']' at position " + std::to_string(pos);
+            return false;
+        }
+
+        // average the branches back into the input bus, stereo if any is
+        bool stereo = false;
+        for (int b : branches) stereo = stereo || busStereo[b];
+        for (int b : branches) {
+            if (stereo && !busStereo[b]) {
+                ops.push_back({ Op::WIDEN, -1, b, b, true, 1.0f });
+                busStereo[b] = true;
+            }
+        }
+        busStereo[bus] = stereo;
+        ops.push_back({ Op::COPY, -1, branches[0], bus, stereo, 1.0f });
+        for (size_t k = 1; k < branches.size(); ++k)
+            ops.push_back({ Op::ADD, -1, branches[k], bus, stereo, 1.0f });
+        if (branches.size() > 1)
+            ops.push_back({ Op::SCALE, -1, bus, bus, stereo, 1.0f / (float)branches.size() });
+        return true;
+    }
+
+    size_t start = pos;
+    while (pos < s.size() && s[pos] != '>' && s[pos] != '|' && s[pos] != '[' && s[pos] != ']')
+        ++pos;
+    size_t end = pos;
+    while (end > start && (s[end - 1] == ' ' || s[end - 1] == '\t')) --end;
+    if (end == start) {
+        error = "missing effect name at position " + std::to_string(start);
+        return false;
+    }
+
+    Node node;
+    node.name = s.substr(start, end - start);
+    node.fx = AnyEffect::create(node.name);
+    if (!node.fx) {
+        error = "unknown effect '" + node.name + "'";
+        return false;
+    }
+    if (node.fx->stereoOut()) {
+        node.mode = busStereo[bus] ? FOLD : SPLIT;
+        busStereo[bus] = true;
+    } else if (busStereo[bus]) {
+        node.mode = DUAL;
+        node.twin = AnyEffect::create(node.name);
+    }
+    node.fadePos = fadeLen;
+
+    ops.push_back({ Op::PROCESS, (int)nodes.size(), bus, bus, false, 1.0f });
+    nodes.push_back(std::move(node));
+    return true;
+}
+
+// ------------------ Setup -----------------------------
+void EffectGraph::prepare(int sampleRate, size_t maxBlockSize) {
+    maxBlock = std::max<size_t>(1, maxBlockSize);
+    const size_t busCount = busStereo.size() * 2 + 2;      // and the two dry buffers
+    size_t bytes = busCount * MemoryArena::bytesFor<float>(maxBlock);
+    for (const Node& node : nodes) {
+        bytes += node.fx->memoryRequirement(sampleRate);
+        if (node.twin) bytes += node.twin->memoryRequirement(sampleRate);
+    }
+    // effects fall back to their own buffers if this fails
+    if (!arena.reserve(bytes)) arena.reserve(0);
+
+    for (Node& node : nodes) {
+        const size_t need = node.fx->memoryRequirement(sampleRate) +
+                            (node.twin ? node.twin->memoryRequirement(sampleRate) : 0);
+        node.arenaFrom = arena.bytesUsed();
+        node.fx->prepare(sampleRate, &arena);
+        if (node.twin) node.twin->prepare(sampleRate, &arena);
+        node.arenaBytes = arena.bytesUsed() - node.arenaFrom;
+        node.ownBuffers = node.arenaBytes < need;
+        node.stale = false;
+    }
+
+    fadeLen = std::max(1, (int)(FADE_MS * 0.001f * sampleRate));
+    fadeTable.resize(fadeLen + 1);
+    for (int k = 0; k <= fadeLen; ++k)
+        fadeTable[k] = std::sin(0.5f * PI * (float)k / (float)fadeLen);
+    for (Node& node : nodes) {
+        node.fadePos = node.on ? fadeLen : 0;
+        node.fading = false;
+    }
+
+    buses.resize(busStereo.size() * 2);
+    scratch.clear();
+    for (float*& bus : buses) bus = buffer(maxBlock);
+    dryL = buffer(maxBlock);
+    dryR = buffer(maxBlock);
+
+    // freshly prepared effects have nothing left to ring
+    holdLen = (size_t)(SILENCE_HOLD_MS * 0.001f * sampleRate);
+    quietFor = ENDLESS_TAIL;
+    tailDirty = true;
+    skipping = false;
+}
+
+// from the arena, or the fallback if it couldn't be reserved
+float* EffectGraph::buffer(size_t n) {
+    if (float* p = arena.allocate<float>(n)) return p;
+    scratch.emplace_back(n, 0.0f);
+    return scratch.back().data();
+}
+
+void EffectGraph::reset() {
+    for (Node& node : nodes) {
+        node.fx->reset();
+        if (node.twin) node.twin->reset();
+        node.stale = false;
+    }
+    quietFor = ENDLESS_TAIL;
+}
+
+void EffectGraph::setSilenceFloor(float db) {
+    silenceFloor = std::pow(10.0f, db / 20.0f);
+}
+
+int EffectGraph::find(const std::string& name) const {
+    for (size_t i = 0; i < nodes.size(); ++i)
+        if (nodes[i].name == name) return (int)i;
+    return -1;
+}
+
+void EffectGraph::setImpulse(const float* ir, size_t length, int sampleRate) {
+    for (Node& node : nodes) {
+        node.fx->setImpulse(ir, length, sampleRate);
+        if (node.twin) node.twin->setImpulse(ir, length, sampleRate);
+    }
+    tailDirty = true;
+}
+
+float EffectGraph::latencySamples() const {
+    // walk the op list tracking each bus's delay; a merge takes the longest
+    std::vector<float> lat(busStereo.size(), 0.0f);
+    for (const Op& op : ops) {
+        switch (op.type) {
+            case Op::PROCESS:
+                if (nodes[op.node].on) lat[op.dst] += nodes[op.node].fx->latencySamples();
+                break;
+            case Op::COPY: lat[op.dst] = lat[op.src]; break;
+            case Op::ADD:  lat[op.dst] = std::max(lat[op.dst], lat[op.src]); break;
+            default: break;
+        }
+    }
+    return lat.empty() ? 0.0f : lat[0];
+}
+
+size_t EffectGraph::graphTail() {
+    // as latencySamples(), with bypassed nodes adding nothing
+    std::fill(busTail.begin(), busTail.end(), 0);
+    for (const Op& op : ops) {
+        switch (op.type) {
+            case Op::PROCESS:
+                if (nodes[op.node].on)
+                    busTail[op.dst] = addTails(busTail[op.dst], nodes[op.node].fx->tailSamples());
+                break;
+            case Op::COPY: busTail[op.dst] = busTail[op.src]; break;
+            case Op::ADD:  busTail[op.dst] = std::max(busTail[op.dst], busTail[op.src]); break;
+            default: break;
+        }
+    }
+    return busTail.empty() ? 0 : busTail[0];
+}
+
+float EffectGraph::cost() const {
+    float total = 0.0f;
+    for (const Node& node : nodes)
+        total += AnyEffect::cost(node.name) * (node.twin ? 2.0f : 1.0f);
+    return total;
+}
+
+// ------------------ Commands --------------------------
+void EffectGraph::setEnabled(size_t index, bool on) {
+    if (index >= nodes.size()) return;
+    Node& node = nodes[index];
+    if (on == node.on) return;
+    // don't resume a stale tail; normally cleared already, else finish now
+    if (on && node.stale) clearNode(node, SIZE_MAX);
+    node.on = on;
+    if (fadeTable.empty()) node.fadePos = on ? fadeLen : 0;   // not prepared yet
+    else node.fading = true;
+    tailDirty = true;
+}
+
+void EffectGraph::setParam(size_t index, int param, float value) {
+    if (index >= nodes.size()) return;
+    nodes[index].fx->setParam(param, value);
+    if (nodes[index].twin) nodes[index].twin->setParam(param, value);
+    tailDirty = true;
+}
+
+void EffectGraph::apply(const EffectCommand& cmd) {
+    if (cmd.effect < 0) return;
+    if (cmd.type == EffectCommand::SET_ENABLED)
+        setEnabled((size_t)cmd.effect, cmd.value != 0.0f);
+    else if (cmd.type == EffectCommand::SET_PARAM)
+        setParam((size_t)cmd.effect, cmd.param, cmd.value);
+}
+
+// ------------------ Processing ------------------------
+void EffectGraph::processBlock(const float* in, float* outL, float* outR, size_t n) {
+    processBlock(in, in, outL, outR, n);
+}
+
+void EffectGraph::processBlock(const float* inL, const float* inR,
+                               float* outL, float* outR, size_t n) {
+    if (maxBlock == 0) {
+        const float* r = inputStereo ? inR : inL;
+        if (outL != inL) std::copy(inL, inL + n, outL);
+        if (outR != r) std::copy(r, r + n, outR);
+        return;
+    }
+
+    clearStale();
+    while (n > 0) {
+        const size_t m = std::min(n, maxBlock);
+        skipping = settled(inL, inR, m);
+        if (skipping) {
+            std::fill(outL, outL + m, 0.0f);
+            std::fill(outR, outR + m, 0.0f);
+            inL += m; inR += m; outL += m; outR += m; n -= m;
+            continue;
+        }
+        std::copy(inL, inL + m, buses[0]);
+        if (inputStereo) std::copy(inR, inR + m, buses[1]);
+
+        for (const Op& op : ops) {
+            float* dL = buses[op.dst * 2];
+            float* dR = buses[op.dst * 2 + 1];
+            const float* sL = buses[op.src * 2];
+            const float* sR = buses[op.src * 2 + 1];
+            switch (op.type) {
+                case Op::PROCESS:
+                    processNode(nodes[op.node], dL, dR, m);
+                    break;
+                case Op::COPY:
+                    std::copy(sL, sL + m, dL);
+                    if (op.stereo) std::copy(sR, sR + m, dR);
+                    break;
+                case Op::WIDEN:
+                    std::copy(dL, dL + m, dR);
+                    break;
+                case Op::ADD:
+                    for (size_t i = 0; i < m; ++i) dL[i] += sL[i];
+                    if (op.stereo) for (size_t i = 0; i < m; ++i) dR[i] += sR[i];
+                    break;
+                case Op::SCALE:
+                    for (size_t i = 0; i < m; ++i) dL[i] *= op.gain;
+                    if (op.stereo) for (size_t i = 0; i < m; ++i) dR[i] *= op.gain;
+                    break;
+            }
+        }
+
+        const float* L = buses[0];
+        const float* R = busStereo[0] ? buses[1] : L;
+        std::copy(L, L + m, outL);
+        std::copy(R, R + m, outR);
+        inL += m; inR += m; outL += m; outR += m; n -= m;
+    }
+}
+
+size_t EffectGraph::clearNode(Node& node, size_t budget) {
+    const size_t k = std::min(budget, node.arenaBytes - node.cleared);
+    arena.clear(node.arenaFrom + node.cleared, k);
+    node.cleared += k;
+    if (node.cleared == node.arenaBytes) {
+        if (node.ownBuffers) {
+            node.fx->reset();
+            if (node.twin) node.twin->reset();
+        } else {
+            node.fx->resetState();
+            if (node.twin) node.twin->resetState();
+        }
+        node.stale = false;
+    }
+    return k;
+}
+
+void EffectGraph::clearStale() {
+    size_t budget = CLEAR_BYTES;
+    for (Node& node : nodes) {
+        if (budget == 0) break;
+        if (node.stale) budget -= clearNode(node, budget);
+    }
+}
+
+bool EffectGraph::settled(const float* inL, const float* inR, size_t n) {
+    // branch-free, so it vectorizes
+    int loud = 0;
+    for (size_t i = 0; i < n; ++i) loud |= (int)(std::fabs(inL[i]) >= silenceFloor);
+    if (inputStereo)
+        for (size_t i = 0; i < n; ++i) loud |= (int)(std::fabs(inR[i]) >= silenceFloor);
+    if (loud) {
+        quietFor = 0;
+        return false;
+    }
+    quietFor = addTails(quietFor, n);
+
+    for (const Node& node : nodes)
+        if (node.fading) return false;
+    if (tailDirty) {
+        tail = graphTail();
+        tailDirty = false;
+    }
+    return quietFor > addTails(tail, holdLen);
+}
+
+void EffectGraph::runNode(Node& node, float* L, float* R, size_t n) {
+    switch (node.mode) {
+        case MONO:
+            node.fx->processBlock(L, L, n);
+            break;
+        case DUAL:
+            node.fx->processBlock(L, L, n);
+            node.twin->processBlock(R, R, n);
+            break;
+        case SPLIT:
+            node.fx->processBlockStereo(L, L, R, n);
+            break;
+        case FOLD:
+            for (size_t i = 0; i < n; ++i) L[i] = 0.5f * (L[i] + R[i]);
+            node.fx->processBlockStereo(L, L, R, n);
+            break;
+    }
+}
+
+void EffectGraph::processNode(Node& node, float* L, float* R, size_t n) {
+    if (!node.fading) {
+        if (node.on) runNode(node, L, R, n);
+        else if (node.mode == SPLIT) std::copy(L, L + n, R);   // bypassed, still widens
+        return;
+    }
+
+    // mid-fade: keep the dry signal and crossfade the effect in or out
+    const bool stereoIn = node.mode == DUAL || node.mode == FOLD;
+    const bool stereoOut = node.mode != MONO;
+    std::copy(L, L + n, dryL);
+    if (stereoOut) std::copy(stereoIn ? R : L, (stereoIn ? R : L) + n, dryR);
+    runNode(node, L, R, n);
+
+    const float* g = fadeTable.data();
+    const int step = node.on ? 1 : -1;
+    int pos = node.fadePos;
+    for (int c = 0; c < (stereoOut ? 2 : 1); ++c) {
+        float* x = c ? R : L;
+        const float* dry = c ? dryR : dryL;
+        pos = node.fadePos;
+        for (size_t i = 0; i < n; ++i) {
+            x[i] = g[fadeLen - pos] * dry[i] + g[pos] * x[i];
+            pos += step;
+            pos = pos < 0 ? 0 : (pos > fadeLen ? fadeLen : pos);
+        }
+    }
+    node.fadePos = pos;
+    if (pos == (node.on ? fadeLen : 0)) node.fading = false;
+    if (pos == 0) {
+        node.stale = true;
+        node.cleared = 0;
+    }
+}
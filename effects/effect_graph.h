@@ -0,0 +1,160 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "any_effect.h"
+#include "effect_command.h"
+#include "memory_arena.h"
+
+// Effect graph chosen at run time: any effects/ class, in any order, with
+// parallel branches. Built from a spec such as
+//
+//     fuzz@2x > [phaser | vibrato > pingpong] > cabinet > reverb
+//
+// '>' is serial, '[a | b | ...]' runs branches side by side on copies of
+// the signal and averages them. Names are AnyEffect names (suffixes like
+// @4x and +adaa1 work). Nodes are numbered in the order they appear; that
+// number is the index EffectCommands use.
+//
+// build() compiles the graph into a flat list of block operations on a few
+// planar buses, so processBlock() is a loop over that list: one virtual
+// processBlock() per node per block and no per-sample branching. A bus is
+// mono until a stereo-output effect (pingpong, allpass) widens it; mono
+// effects after that point run as a second instance on the right channel,
+// stereo-output effects take the two channels folded to mono.
+//
+// Nodes start enabled. Enabling or bypassing one crossfades its output
+// against its input over FADE_MS; only nodes mid-fade take the slower
+// path. setEnabled()/setParam()/apply() belong to the audio thread once
+// processing has started, normally fed from an SpscQueue.
+//
+// A node that has faded out is cleared so it won't come back with a stale
+// tail: its span of the arena is zeroed CLEAR_BYTES per block, then
+// AnyEffect::resetState() puts back the rest. A reverb's megabytes of
+// delay line are never zeroed within one callback, unless the node is
+// switched on again before its clear has finished.
+//
+// The effects' delay lines and the graph's own buses share one
+// MemoryArena, sized in prepare(); preparing again at the same or a lower
+// rate and block size reuses it.
+//
+// Once the input has stayed under the silence floor for longer than the
+// graph's tail (every enabled node's AnyEffect::tailSamples(), summed along
+// the longest branch) plus SILENCE_HOLD_MS, processBlock() writes zeros and
+// runs nothing, until a block comes in with anything over the floor; that
+// block is processed as usual. Effects are left as they were, with only
+// what's under the floor in them; LFOs carry on from where they stopped.
+// Never while a node is fading.
+class EffectGraph {
+public:
+    static constexpr float FADE_MS = 10.0f;
+    static constexpr float SILENCE_DB = -80.0f;         // dBFS, default floor
+    static constexpr float SILENCE_HOLD_MS = 50.0f;
+    static constexpr size_t CLEAR_BYTES = 256 * 1024;   // per block, see above
+
+    // false and a message for a malformed spec or unknown effect.
+    // stereoIn builds for the two-channel processBlock() below.
+    bool build(const std::string& spec, std::string& error, bool stereoIn = false);
+    // allocates; blocks passed to processBlock() may be any length
+    void prepare(int sampleRate, size_t maxBlock);
+    // bytes of the arena prepare() laid out
+    size_t memoryUsed() const { return arena.bytesUsed(); }
+    void reset();
+    // input peaks under db dBFS count as silence; -INFINITY never skips
+    void setSilenceFloor(float db);
+    // the last block was skipped
+    bool idle() const { return skipping; }
+
+    size_t size() const { return nodes.size(); }
+    const std::string& nodeName(size_t index) const { return nodes[index].name; }
+    // first node with that name (suffixes included), or -1
+    int find(const std::string& name) const;
+    // impulse response for every cabinet node; before prepare()
+    void setImpulse(const float* ir, size_t length, int sampleRate);
+
+    void setEnabled(size_t index, bool on);
+    bool enabled(size_t index) const { return index < nodes.size() && nodes[index].on; }
+    void setParam(size_t index, int param, float value);
+    void apply(const EffectCommand& cmd);
+
+    // delay through the enabled nodes (longest branch), in samples
+    float latencySamples() const;
+    // AnyEffect::cost() summed over every instance, enabled or not
+    float cost() const;
+    bool stereoOutput() const { return !busStereo.empty() && busStereo[0]; }
+
+    // mono in, planar stereo out; in may alias outL
+    void processBlock(const float* in, float* outL, float* outR, size_t n);
+    // planar stereo in for graphs built with stereoIn (inR is ignored
+    // otherwise); ins may alias outs
+    void processBlock(const float* inL, const float* inR, float* outL, float* outR, size_t n);
+
+private:
+    // how a node meets its bus, fixed when the graph is compiled
+    enum Mode {
+        MONO,        // mono effect, mono bus
+        DUAL,        // mono effect on each channel of a stereo bus
+        SPLIT,       // stereo-output effect, mono bus becomes stereo
+        FOLD         // stereo-output effect fed the stereo bus summed to mono
+    };
+
+    struct Node {
+        std::string name;
+        std::unique_ptr<AnyEffect> fx, twin;   // twin: right channel in DUAL
+        Mode mode = MONO;
+        bool on = true;                        // target state
+        bool fading = false;
+        int fadePos = 0;                       // 0 = bypassed, fadeLen = fully on
+        size_t arenaFrom = 0, arenaBytes = 0;  // span fx and twin were prepared in
+        bool ownBuffers = false;               // some of theirs aren't in it
+        bool stale = false;                    // faded out, not yet cleared
+        size_t cleared = 0;                    // bytes of the span zeroed so far
+    };
+
+    struct Op {
+        enum Type { PROCESS, COPY, WIDEN, ADD, SCALE };
+        Type type;
+        int node;            // PROCESS
+        int src, dst;        // dst is the bus for PROCESS, WIDEN, SCALE
+        bool stereo;         // COPY, ADD, SCALE: both channels
+        float gain;          // SCALE
+    };
+
+    // recursive-descent compile; each returns false with error set
+    bool compileChain(const std::string& s, size_t& pos, int bus, std::string& error);
+    bool compileItem(const std::string& s, size_t& pos, int bus, std::string& error);
+    int newBus(bool stereo);
+
+    float* buffer(size_t n);
+    // input quiet long enough for every tail to have died away
+    bool settled(const float* inL, const float* inR, size_t n);
+    size_t graphTail();
+    // zeroes up to `budget` bytes of a stale node's span, resets it once done
+    size_t clearNode(Node& node, size_t budget);
+    void clearStale();
+    void runNode(Node& node, float* L, float* R, size_t n);
+    void processNode(Node& node, float* L, float* R, size_t n);
+
+    std::vector<Node> nodes;
+    std::vector<Op> ops;
+    std::vector<bool> busStereo;               // compile-time channel count per bus
+    MemoryArena arena;
+    std::vector<float*> buses;                 // [bus * 2 + channel], maxBlock each
+    float* dryL = nullptr;
+    float* dryR = nullptr;
+    std::vector<std::vector<float>> scratch;   // buses if the arena couldn't be had
+    std::vector<float> fadeTable;              // sin quarter-wave, fadeLen + 1 entries
+    size_t maxBlock = 0;
+    int fadeLen = 1;
+    bool inputStereo = false;
+
+    float silenceFloor = 1e-4f;                // SILENCE_DB as a linear peak
+    size_t quietFor = 0;                       // input samples under it so far
+    size_t holdLen = 0;
+    size_t tail = 0;                           // graphTail(), while !tailDirty
+    bool tailDirty = true;
+    bool skipping = false;
+    std::vector<size_t> busTail;               // graphTail()'s per-bus scratch
+};
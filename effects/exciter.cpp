@@ -1,27 +1,79 @@
 #include "exciter.h"
+#include "denormal.h"
+#include "fast_math.h"
 #include <cmath>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-Exciter::Exciter() : hpState(0.0f), hpCoeff(0.0f), mix(0.4f) {}
+Exciter::Exciter() : lastIn(0.0f), hpState(0.0f), hpCoeff(0.0f), mix(0.4f) {}
 
 void Exciter::prepare(int sampleRate) {
     float cutoff = 3000.0f;
-    float x = expf(-2.0f * M_PI * cutoff / sampleRate);
+    float x = fastExp(-2.0f * M_PI * cutoff / sampleRate);
     hpCoeff = x;
 }
 
 float Exciter::process(float in) {
-    float hp = in - hpState;
-    hpState = hpState * hpCoeff + in * (1.0f - hpCoeff);
+    float out;
+    processBlock(&in, &out, 1);
+    return out;
+}
+
+void Exciter::processBlock(const float* in, float* out, size_t n) {
+    float z = hpState;
+    const float a = hpCoeff, b = 1.0f - hpCoeff;
+    const float dry = 1.0f - mix, wet = mix;
 
-    float harmonic = tanhf(hp * 4.0f);
+    if (shaper.order() > 0) {
+        // the dry signal takes the shaper's delay the way ADAA takes it
+        // below clipping: order 1 averages two inputs (half a sample),
+        // order 2 is a sample late
+        const float now = shaper.order() == 1 ? 0.5f : 0.0f, before = 1.0f - now;
+        float h[CHUNK], d[CHUNK];
+        while (n > 0) {
+            size_t m = n < CHUNK ? n : CHUNK;
+            for (size_t i = 0; i < m; ++i) {
+                float x = in[i];
+                h[i] = (x - z) * 4.0f;
+                z = flushDenormal(z * a + x * b);
+                d[i] = (x * now + lastIn * before) * dry;
+                lastIn = x;
+            }
+            shaper.processBlock(h, h, m);
+            for (size_t i = 0; i < m; ++i) out[i] = d[i] + h[i] * wet;
+            in += m; out += m; n -= m;
+        }
+        hpState = z;
+        return;
+    }
 
-    return in * (1.0f - mix) + harmonic * mix;
+    for (size_t i = 0; i < n; ++i) {
+        float x = in[i];
+        float hp = x - z;
+        z = flushDenormal(z * a + x * b);
+        out[i] = x * dry + fastTanh(hp * 4.0f) * wet;
+    }
+    hpState = z;
 }
 
 void Exciter::reset() {
+    lastIn = 0.0f;
     hpState = 0.0f;
+    shaper.reset();
+}
+
+void Exciter::setMix(float m) {
+    mix = m < 0.0f ? 0.0f : (m > 1.0f ? 1.0f : m);
+}
+
+void Exciter::setParam(int id, float value) {
+    if (id == PARAM_MIX) setMix(value);
+    else if (id == PARAM_ADAA) {
+        // a new order starts the shaper from silence; the dry delay too
+        const int old = shaper.order();
+        shaper.setOrder((int)std::lround(value));
+        if (shaper.order() != old) lastIn = 0.0f;
+    }
 }
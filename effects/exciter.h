@@ -1,14 +1,29 @@
 #pragma once
 #include <cmath>
+#include <cstddef>
+#include "waveshaper.h"
 
 class Exciter {
 public:
     Exciter();
     void prepare(int sampleRate);
     float process(float in);
+    // process n samples; in and out may alias
+    void processBlock(const float* in, float* out, size_t n);
     void reset();
 
+    // PARAM_ADAA: 0 = plain tanh, 1/2 = first/second-order anti-aliased.
+    // Fixed id, shared with AnyEffect::PARAM_ADAA.
+    enum Param { PARAM_MIX, PARAM_ADAA = 32 };
+    void setMix(float m);
+    void setParam(int id, float value);
+    // the ADAA shaper's; the dry signal is delayed to match
+    float latencySamples() const { return shaper.latencySamples(); }
+
 private:
+    static constexpr size_t CHUNK = 128;
+    Waveshaper<TanhClip> shaper;
+    float lastIn;                    // for the dry path's delay under ADAA
     float hpState;
     float hpCoeff;
     float mix;
@@ -0,0 +1,336 @@
+#include "fdn_reverb.h"
+#include "denormal.h"
+#include "fast_math.h"
+#include "tail.h"
+#include <algorithm>
+#include <cmath>
+
+static const float TWO_PI = 6.28318530717958647692f;
+
+// Mutually prime delay lengths at 48 kHz and size 1 (roughly 23-95 ms)
+static const int BASE_DELAYS[FdnReverb::MAX_LINES] = {
+    1123, 1381, 1579, 1777, 1949, 2161, 2393, 2579,
+    2791, 3011, 3229, 3469, 3701, 3967, 4219, 4567
+};
+
+FdnReverb::FdnReverb()
+: sampleRate(48000), lines(8), matrix(HADAMARD), size(1.0f), decay(2.5f), damping(0.4f),
+  modDepth(0.3f), buffer(nullptr), capacity(0), mask(0), writeRow(0), clearPos(0), modLeft(MOD_HOLD), dampCoeff(0.0f)
+{
+    for (int k = 0; k < MAX_LINES; ++k) {
+        delay[k] = 1.0f; gain[k] = 0.0f; lp[k] = 0.0f;
+        modPhase[k] = 0.0f; modInc[k] = 0.0f; modSin[k] = 0.0f;
+        inSign[k] = (k & 1) ? -1.0f : 1.0f;
+        outSign[k] = (k & 2) ? -1.0f : 1.0f;
+    }
+}
+
+// sized for the largest size setting so setSize() never allocates
+size_t FdnReverb::lineCapacity(int sr) {
+    float scale = (float)sr / 48000.0f;
+    size_t need = (size_t)(BASE_DELAYS[MAX_LINES - 1] * scale * MAX_SIZE) +
+                  (size_t)std::ceil(MAX_MOD_SAMPLES * scale) + 4;
+    size_t c = 1;
+    while (c < need) c <<= 1;
+    return c;
+}
+
+size_t FdnReverb::memoryRequirement(int sr) const {
+    return MemoryArena::bytesFor<float>(lineCapacity(sr) * MAX_LINES);
+}
+
+void FdnReverb::prepare(int sr, MemoryArena* arena) {
+    sampleRate = sr;
+
+    capacity = lineCapacity(sr);
+    mask = capacity - 1;
+    buffer = arena ? arena->allocate<float>(capacity * MAX_LINES) : nullptr;
+    if (buffer) {
+        std::vector<float>().swap(own);
+    } else {
+        own.assign(capacity * MAX_LINES, 0.0f);
+        buffer = own.data();
+    }
+    writeRow = 0;
+
+    // each line's LFO runs at a slightly different rate around 0.5 Hz
+    for (int k = 0; k < MAX_LINES; ++k) {
+        float rate = 0.35f + 0.023f * (float)k;
+        modInc[k] = TWO_PI * rate / (float)sr;
+        modPhase[k] = TWO_PI * (float)k / (float)MAX_LINES;
+        modSin[k] = fastSin(modPhase[k]);
+    }
+    modLeft = MOD_HOLD;
+    updateDelays();
+    reset();
+}
+
+void FdnReverb::reset() {
+    if (buffer) std::fill(buffer, buffer + capacity * MAX_LINES, 0.0f);
+    resetState();
+}
+
+void FdnReverb::resetState() {
+    std::fill(lp, lp + MAX_LINES, 0.0f);
+    writeRow = 0;
+    clearPos = capacity * MAX_LINES;
+}
+
+void FdnReverb::release() {
+    buffer = nullptr;
+    std::vector<float>().swap(own);
+}
+
+bool FdnReverb::clearSlice(size_t bytes) {
+    const size_t total = capacity * MAX_LINES;
+    if (clearPos >= total) return true;
+    size_t n = std::min(total - clearPos, std::max<size_t>(1, bytes / sizeof(float)));
+    if (buffer) std::fill(buffer + clearPos, buffer + clearPos + n, 0.0f);
+    clearPos += n;
+    if (clearPos < total) return false;
+    resetState();
+    return true;
+}
+
+void FdnReverb::setLines(int n) {
+    int l = n >= 16 ? 16 : 8;
+    if (l != lines) {
+        lines = l;
+        updateDelays();
+    }
+}
+
+void FdnReverb::setMatrix(Matrix m) { matrix = m; }
+
+void FdnReverb::setSize(float s) {
+    size = std::min(MAX_SIZE, std::max(0.25f, s));
+    updateDelays();
+}
+
+void FdnReverb::setDecay(float seconds) {
+    decay = std::max(0.05f, seconds);
+    updateDelays();
+}
+
+void FdnReverb::setDamping(float amount) {
+    damping = std::min(0.95f, std::max(0.0f, amount));
+    updateDamping();
+}
+
+// damping is the filter pole at 48 kHz; the same time constant elsewhere
+void FdnReverb::updateDamping() {
+    dampCoeff = sampleRate == 48000 ? damping : std::pow(damping, 48000.0f / (float)sampleRate);
+}
+
+void FdnReverb::setModulation(float depth) {
+    modDepth = std::min(1.0f, std::max(0.0f, depth));
+}
+
+size_t FdnReverb::tailSamples() const {
+    // decay is the RT60; the longest line adds the last trip
+    float longest = 0.0f;
+    for (int k = 0; k < lines; ++k) longest = std::max(longest, delay[k]);
+    return (size_t)std::ceil(decay * (TAIL_DB / 60.0f) * (float)sampleRate + longest + MAX_MOD_SAMPLES);
+}
+
+void FdnReverb::updateDelays() {
+    // with 8 lines take every other length so the spread stays the same
+    const int stride = MAX_LINES / lines;
+    const float scale = (float)sampleRate / 48000.0f * size;
+    for (int k = 0; k < MAX_LINES; ++k) {
+        float d = (float)BASE_DELAYS[std::min(k * stride, MAX_LINES - 1)] * scale;
+        delay[k] = std::max(2.0f, d);
+        // -60 dB after `decay` seconds: g^(sr*decay/d) = 1e-3
+        gain[k] = fastExp(-6.90775527898f * delay[k] / (decay * (float)sampleRate));  // ln(1e-3)
+    }
+    updateDamping();
+}
+
+float FdnReverb::process(float in) {
+    float out;
+    processBlock(&in, &out, 1);
+    return out;
+}
+
+void FdnReverb::processBlock(const float* in, float* out, size_t n) {
+    if (!buffer) {
+        if (out != in) std::copy(in, in + n, out);
+        return;
+    }
+    if (lines == 16) {
+        if (matrix == HADAMARD) run<16, HADAMARD>(in, out, n);
+        else run<16, HOUSEHOLDER>(in, out, n);
+    } else {
+        if (matrix == HADAMARD) run<8, HADAMARD>(in, out, n);
+        else run<8, HOUSEHOLDER>(in, out, n);
+    }
+}
+
+// fast Walsh-Hadamard transform across the N rows of v, in place, on
+// samples [0, mv) of each; unrolled at compile time, two stages per pass
+// over the rows where it can, each butterfly a loop of whole LANES groups
+template <int N, size_t C, size_t LANES, int H = 1>
+static inline void hadamard(float (*v)[C], size_t mv) {
+    if constexpr (4 * H <= N) {
+        for (int a = 0; a < N; a += 4 * H)
+            for (int b = a; b < a + H; ++b) {
+                float* p0 = v[b];
+                float* p1 = v[b + H];
+                float* p2 = v[b + 2 * H];
+                float* p3 = v[b + 3 * H];
+                for (size_t j = 0; j < mv; j += LANES)
+                    for (size_t l = 0; l < LANES; ++l) {
+                        float s0 = p0[j + l] + p1[j + l], s1 = p0[j + l] - p1[j + l];
+                        float s2 = p2[j + l] + p3[j + l], s3 = p2[j + l] - p3[j + l];
+                        p0[j + l] = s0 + s2;
+                        p1[j + l] = s1 + s3;
+                        p2[j + l] = s0 - s2;
+                        p3[j + l] = s1 - s3;
+                    }
+            }
+        hadamard<N, C, LANES, 4 * H>(v, mv);
+    } else if constexpr (H < N) {
+        for (int a = 0; a < N; a += 2 * H)
+            for (int b = a; b < a + H; ++b) {
+                float* p = v[b];
+                float* q = v[b + H];
+                for (size_t j = 0; j < mv; j += LANES)
+                    for (size_t l = 0; l < LANES; ++l) {
+                        float u = p[j + l], w = q[j + l];
+                        p[j + l] = u + w;
+                        q[j + l] = u - w;
+                    }
+            }
+    }
+}
+
+// one step of every line's damping lowpass, z = b*y + damp*z, for
+// sample j; unrolled at compile time so the states stay in registers
+template <int N, size_t C, int K = 0>
+static inline void dampLines(float (*y)[C], size_t j, float* z, const float* b, float d) {
+    if constexpr (K < N) {
+        z[K] = flushDenormal(b[K] * y[K][j] + d * z[K]);
+        y[K][j] = z[K];
+        dampLines<N, C, K + 1>(y, j, z, b, d);
+    }
+}
+
+template <int N, FdnReverb::Matrix M>
+void FdnReverb::run(const float* in, float* out, size_t n) {
+    float* buf = buffer;
+    const float depth = modDepth * (float)MAX_MOD_SAMPLES * ((float)sampleRate / 48000.0f) * 0.5f;
+    const float damp = dampCoeff, undamp = 1.0f - dampCoeff;
+    const float norm = 1.0f / std::sqrt((float)N);   // input, output and Hadamard scaling
+    const float householder = 2.0f / (float)N;
+
+    // lines are at least this long, so a chunk never reads what it writes
+    size_t minDelay = (size_t)delay[0];
+    for (int k = 1; k < N; ++k) minDelay = std::min(minDelay, (size_t)delay[k]);
+    const size_t maxChunk = std::max<size_t>(1, std::min(CHUNK, minDelay));
+
+    // line-major scratch, y[k][j] is line k at chunk sample j, so every
+    // pass but the damping runs along rows, in whole LANES groups
+    alignas(64) float y[N][CHUNK];
+    alignas(64) float x[CHUNK], sum[CHUNK];
+    // the RT60 gain (and the Hadamard scaling) goes in ahead of the
+    // damping, which is linear, so the filter state carries it
+    const float scale = M == HADAMARD ? norm : 1.0f;
+    float z[N], b[N], inS[N], outS[N];
+    for (int k = 0; k < N; ++k) {
+        z[k] = lp[k];
+        b[k] = undamp * gain[k] * scale;
+        inS[k] = inSign[k] * norm;
+        outS[k] = outSign[k] * norm;
+    }
+
+    while (n > 0) {
+        const size_t m = std::min(std::min(n, maxChunk), modLeft);
+        const size_t mv = (m + LANES - 1) & ~(LANES - 1);
+        const size_t w = writeRow;
+
+        // in and out may alias
+        std::copy(in, in + m, x);
+
+        // 1) read every line for the whole chunk and sum the output taps.
+        //    Modulation moves the delay by a few samples per second, so
+        //    it's held for MOD_HOLD.
+        std::fill(sum, sum + mv, 0.0f);
+        for (int k = 0; k < N; ++k) {
+            float d = delay[k] + depth * (1.0f + modSin[k]);
+            size_t whole = (size_t)d;
+            float frac = d - (float)whole;
+            const float* line = buf + k * capacity;
+            const float sign = outS[k];
+            float* row = y[k];
+            size_t r0 = (w - whole - 1) & mask;   // one older sample for the lerp
+            if (r0 + mv < capacity) {
+                const float* p = line + r0;
+                for (size_t j = 0; j < mv; j += LANES)
+                    for (size_t l = 0; l < LANES; ++l) {
+                        float v = p[j + l + 1] + frac * (p[j + l] - p[j + l + 1]);
+                        row[j + l] = v;
+                        sum[j + l] += v * sign;
+                    }
+            } else {
+                for (size_t j = 0; j < m; ++j) {
+                    float a = line[(r0 + j + 1) & mask];
+                    float b = line[(r0 + j) & mask];
+                    row[j] = a + frac * (b - a);
+                }
+                std::fill(row + m, row + mv, 0.0f);
+                for (size_t j = 0; j < mv; j += LANES)
+                    for (size_t l = 0; l < LANES; ++l) sum[j + l] += row[j + l] * sign;
+            }
+        }
+        std::copy(sum, sum + m, out);
+
+        // 2) RT60 gain and damping lowpass. A recursion along each row,
+        //    so it steps all the lines a sample at a time.
+        for (size_t j = 0; j < m; ++j) dampLines<N, CHUNK>(y, j, z, b, damp);
+
+        // 3) lossless feedback matrix
+        if constexpr (M == HADAMARD) {
+            hadamard<N, CHUNK, LANES>(y, mv);
+        } else {
+            std::fill(sum, sum + mv, 0.0f);
+            for (int k = 0; k < N; ++k)
+                for (size_t j = 0; j < mv; j += LANES)
+                    for (size_t l = 0; l < LANES; ++l) sum[j + l] += y[k][j + l];
+            for (size_t j = 0; j < mv; j += LANES)
+                for (size_t l = 0; l < LANES; ++l) sum[j + l] *= householder;
+            for (int k = 0; k < N; ++k)
+                for (size_t j = 0; j < mv; j += LANES)
+                    for (size_t l = 0; l < LANES; ++l) y[k][j + l] -= sum[j + l];
+        }
+
+        // 4) inject the input and write the chunk back, a line at a time;
+        //    whole groups straight into the line, the rest one by one
+        const size_t nv = w + m <= capacity ? m & ~(LANES - 1) : 0;
+        for (int k = 0; k < N; ++k) {
+            float* line = buf + k * capacity;
+            const float* row = y[k];
+            const float sign = inS[k];
+            float* p = line + w;
+            for (size_t j = 0; j < nv; j += LANES)
+                for (size_t l = 0; l < LANES; ++l) p[j + l] = flushDenormal(row[j + l] + x[j + l] * sign);
+            for (size_t j = nv; j < m; ++j)
+                line[(w + j) & mask] = flushDenormal(row[j] + x[j] * sign);
+        }
+        writeRow = (w + m) & mask;
+
+        // 5) step the LFOs at the end of each hold
+        modLeft -= m;
+        if (modLeft == 0) {
+            for (int k = 0; k < N; ++k) {
+                modPhase[k] += modInc[k] * (float)MOD_HOLD;
+                if (modPhase[k] >= TWO_PI) modPhase[k] -= TWO_PI;
+                modSin[k] = fastSin(modPhase[k]);
+            }
+            modLeft = MOD_HOLD;
+        }
+
+        in += m; out += m; n -= m;
+    }
+
+    std::copy(z, z + N, lp);
+}
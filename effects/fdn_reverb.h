@@ -0,0 +1,87 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+#include "memory_arena.h"
+
+// Feedback delay network reverb with 8 or 16 lines.
+//
+// All lines live in one contiguous allocation, one power-of-two region per
+// line. Lines are at least a chunk long, so a chunk of every line is read
+// into a row of scratch, and the lerp, output taps, feedback matrix and
+// input run along the rows in whole LANES groups, which vectorize at -O2.
+// Only the damping lowpass is a recursion in time; it steps all the lines
+// a sample at a time, unrolled so its states stay in registers. The rows
+// are then written back to the lines. Output is wet only, like Reverb.
+class FdnReverb {
+public:
+    static const int MAX_LINES = 16;
+    enum Matrix { HADAMARD, HOUSEHOLDER };
+
+    FdnReverb();
+    FdnReverb(const FdnReverb&) = delete;
+    FdnReverb& operator=(const FdnReverb&) = delete;
+    // arena bytes prepare(sampleRate, arena) takes
+    size_t memoryRequirement(int sampleRate) const;
+    // lines from the arena if one is given, else allocated
+    void prepare(int sampleRate, MemoryArena* arena = nullptr);
+    float process(float in);
+    void processBlock(const float* in, float* out, size_t n);
+    void reset();
+    // reset() but for the lines, for an owner that has zeroed its arena
+    void resetState();
+    // gives the lines back; processBlock() passes the input through
+    // until the next prepare()
+    void release();
+    bool hasLines() const { return buffer != nullptr; }
+
+    // clears the lines over several calls instead of in one go: after
+    // beginClear(), each clearSlice() zeroes up to `bytes` more of them
+    // and returns true once they are all clear
+    void beginClear() { clearPos = 0; }
+    bool clearSlice(size_t bytes);
+
+    void setLines(int lines);          // 8 or 16
+    void setMatrix(Matrix m);
+    void setSize(float size);          // 0.25..2, scales every delay length
+    void setDecay(float seconds);      // RT60
+    void setDamping(float amount);     // 0 = bright .. 1 = dark
+    void setModulation(float depth);   // 0..1, up to MAX_MOD_SAMPLES (at 48 kHz) of delay wobble
+    // samples it rings for once the input stops (tail.h)
+    size_t tailSamples() const;
+
+private:
+    static const int MAX_MOD_SAMPLES = 8;
+    static constexpr size_t CHUNK = 128;
+    static constexpr size_t LANES = 8;
+    // the LFOs step every MOD_HOLD samples, counted from prepare(), so
+    // the output doesn't depend on how the input is split into blocks
+    static constexpr size_t MOD_HOLD = CHUNK;
+    static constexpr float MAX_SIZE = 2.0f;
+
+    template <int N, Matrix M> void run(const float* in, float* out, size_t n);
+    void updateDelays();
+    void updateDamping();
+    static size_t lineCapacity(int sampleRate);
+
+    int sampleRate;
+    int lines;
+    Matrix matrix;
+    float size, decay, damping, modDepth;
+
+    std::vector<float> own;        // unless the lines are in an arena
+    float* buffer;                 // MAX_LINES lines of `capacity` samples
+    size_t capacity;               // per line, power of two
+    size_t mask;
+    size_t writeRow;               // shared write position
+    size_t clearPos;               // samples of the lines zeroed since beginClear()
+    size_t modLeft;                // samples until the LFOs next step
+
+    // per line
+    float delay[MAX_LINES];        // samples
+    float gain[MAX_LINES];         // per-pass gain for the RT60
+    float lp[MAX_LINES];           // damping filter state, gain applied
+    float modPhase[MAX_LINES], modInc[MAX_LINES], modSin[MAX_LINES];  // LFO, held MOD_HOLD samples
+    float inSign[MAX_LINES], outSign[MAX_LINES];
+    float dampCoeff;
+};
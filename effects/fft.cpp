@@ -0,0 +1,125 @@
+#include "fft.h"
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+void Fft::prepare(size_t size) {
+    n = size < 4 ? 4 : size;
+    half = n / 2;
+
+    unsigned bits = 0;
+    while ((size_t(1) << bits) < half) ++bits;
+    bitrev.assign(half, 0);
+    for (size_t k = 0; k < half; ++k) {
+        unsigned r = 0;
+        for (unsigned b = 0; b < bits; ++b)
+            if (k & (size_t(1) << b)) r |= 1u << (bits - 1 - b);
+        bitrev[k] = r;
+    }
+
+    // stage with span L keeps its L twiddles at offset L - 1
+    stageCos.assign(half > 1 ? half - 1 : 1, 1.0f);
+    stageSin.assign(half > 1 ? half - 1 : 1, 0.0f);
+    for (size_t L = 1; L < half; L <<= 1)
+        for (size_t j = 0; j < L; ++j) {
+            double a = -M_PI * (double)j / (double)L;
+            stageCos[L - 1 + j] = (float)std::cos(a);
+            stageSin[L - 1 + j] = (float)std::sin(a);
+        }
+
+    postCos.assign(half + 1, 0.0f);
+    postSin.assign(half + 1, 0.0f);
+    for (size_t k = 0; k <= half; ++k) {
+        double a = 2.0 * M_PI * (double)k / (double)n;
+        postCos[k] = (float)std::cos(a);
+        postSin[k] = (float)std::sin(a);
+    }
+
+    zr.assign(half, 0.0f);
+    zi.assign(half, 0.0f);
+}
+
+// in place, input already in bit-reversed order
+void Fft::complexForward(float* re, float* im) {
+    for (size_t L = 1; L < half; L <<= 1) {
+        const float* wc = stageCos.data() + L - 1;
+        const float* ws = stageSin.data() + L - 1;
+        for (size_t start = 0; start < half; start += 2 * L) {
+            float* ar = re + start;  float* ai = im + start;
+            float* br = ar + L;      float* bi = ai + L;
+            if (L < LANES) {
+                for (size_t j = 0; j < L; ++j) {
+                    float tr = br[j] * wc[j] - bi[j] * ws[j];
+                    float ti = br[j] * ws[j] + bi[j] * wc[j];
+                    br[j] = ar[j] - tr;
+                    bi[j] = ai[j] - ti;
+                    ar[j] += tr;
+                    ai[j] += ti;
+                }
+                continue;
+            }
+            // whole groups, all loads before any store so they vectorize
+            for (size_t j = 0; j < L; j += LANES) {
+                float tr[LANES], ti[LANES], xr[LANES], xi[LANES];
+                for (size_t v = 0; v < LANES; ++v) {
+                    tr[v] = br[j + v] * wc[j + v] - bi[j + v] * ws[j + v];
+                    ti[v] = br[j + v] * ws[j + v] + bi[j + v] * wc[j + v];
+                    xr[v] = ar[j + v];
+                    xi[v] = ai[j + v];
+                }
+                for (size_t v = 0; v < LANES; ++v) {
+                    br[j + v] = xr[v] - tr[v];
+                    bi[j + v] = xi[v] - ti[v];
+                    ar[j + v] = xr[v] + tr[v];
+                    ai[j + v] = xi[v] + ti[v];
+                }
+            }
+        }
+    }
+}
+
+void Fft::forward(const float* in, float* re, float* im) {
+    // pack even/odd samples as one half-size complex signal
+    for (size_t k = 0; k < half; ++k) {
+        zr[bitrev[k]] = in[2 * k];
+        zi[bitrev[k]] = in[2 * k + 1];
+    }
+    complexForward(zr.data(), zi.data());
+
+    // split into the even and odd spectra and combine
+    for (size_t k = 0; k <= half; ++k) {
+        size_t a = k == half ? 0 : k;
+        size_t b = k == 0 ? 0 : half - k;
+        float ar = zr[a], ai = zi[a];
+        float br = zr[b], bi = -zi[b];
+        float er = 0.5f * (ar + br), ei = 0.5f * (ai + bi);
+        float orr = 0.5f * (ai - bi), oi = -0.5f * (ar - br);
+        float c = postCos[k], s = postSin[k];
+        re[k] = er + c * orr + s * oi;
+        im[k] = ei + c * oi - s * orr;
+    }
+}
+
+void Fft::inverse(const float* re, const float* im, float* out) {
+    for (size_t k = 0; k < half; ++k) {
+        float ar = re[k], ai = im[k];
+        float br = re[half - k], bi = -im[half - k];
+        float er = 0.5f * (ar + br), ei = 0.5f * (ai + bi);
+        float dr = 0.5f * (ar - br), di = 0.5f * (ai - bi);
+        // odd spectrum = d / W^k
+        float c = postCos[k], s = postSin[k];
+        float orr = dr * c - di * s, oi = dr * s + di * c;
+        // z = even + i * odd, conjugated so the forward kernel inverts it
+        zr[bitrev[k]] = er - oi;
+        zi[bitrev[k]] = -(ei + orr);
+    }
+    complexForward(zr.data(), zi.data());
+
+    const float scale = 1.0f / (float)half;
+    for (size_t k = 0; k < half; ++k) {
+        out[2 * k] = zr[k] * scale;
+        out[2 * k + 1] = -zi[k] * scale;
+    }
+}
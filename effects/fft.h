@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+// Real FFT for power-of-two sizes, radix-2, split real/imaginary arrays.
+//
+// A size-n real transform runs as an n/2 complex transform plus one
+// post-processing pass. Twiddles are stored contiguously per stage so the
+// butterfly loops are plain unit-stride float loops the compiler vectorizes.
+// prepare() allocates; forward() and inverse() don't.
+class Fft {
+public:
+    void prepare(size_t n);            // n >= 4, power of two
+    size_t size() const { return n; }
+    size_t bins() const { return n / 2 + 1; }
+
+    // n real samples -> bins() complex values (DC .. Nyquist)
+    void forward(const float* in, float* re, float* im);
+
+    // bins() complex values -> n real samples, scaled so inverse(forward(x)) == x
+    void inverse(const float* re, const float* im, float* out);
+
+private:
+    static constexpr size_t LANES = 8;   // butterfly group width
+
+    void complexForward(float* re, float* im);
+
+    size_t n = 0;
+    size_t half = 0;
+    std::vector<unsigned> bitrev;          // half entries
+    std::vector<float> stageCos, stageSin; // half - 1 entries, stage by stage
+    std::vector<float> postCos, postSin;   // real split twiddles, half + 1 entries
+    std::vector<float> zr, zi;             // scratch
+};
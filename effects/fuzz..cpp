@@ -1,4 +1,6 @@
 #include "fuzz.h"
+#include "denormal.h"
+#include "fast_math.h"
 #include <cmath>
 #include <algorithm>
 
@@ -22,27 +24,27 @@ void Fuzz::prepare(int sr) {
 
 
 void Fuzz::setHighpass(float cutoff) {
-    float x = expf(-2.0f * M_PI * cutoff / (float)sampleRate);
+    float x = fastExp(-2.0f * M_PI * cutoff / (float)sampleRate);
     hpf_a = (1.0f + x) * 0.5f;
     hpf_b = x;
 }
 
 
 void Fuzz::setLowpass(float cutoff) {
-    float x = expf(-2.0f * M_PI * cutoff / (float)sampleRate);
+    float x = fastExp(-2.0f * M_PI * cutoff / (float)sampleRate);
     lpf_a = 1.0f - x;
     lpf_b = x;
 }
 
 
 float Fuzz::hpf_process(float in) {
-    hpf_z = hpf_a * (in - hpf_z) + hpf_z * hpf_b;
+    hpf_z = flushDenormal(hpf_a * (in - hpf_z) + hpf_z * hpf_b);
     return hpf_z;
 }
 
 
 float Fuzz::lpf_process(float in) {
-    lpf_z = lpf_a * in + lpf_b * lpf_z;
+    lpf_z = flushDenormal(lpf_a * in + lpf_b * lpf_z);
     return lpf_z;
 }
 
@@ -51,13 +53,63 @@ float Fuzz::process(float in) {
     float x = in;
     x = hpf_process(x);
     x *= inputGain;
-    if (x > clipLevel) x = clipLevel;
-    if (x < -clipLevel) x = -clipLevel;
+    if (clipper.order() > 0) {
+        x = clipper.process(x / clipLevel) * clipLevel;
+    } else {
+        if (x > clipLevel) x = clipLevel;
+        if (x < -clipLevel) x = -clipLevel;
+    }
     x = lpf_process(x);
     return x;
 }
 
 
+void Fuzz::processBlock(const float* in, float* out, size_t n) {
+    float hz = hpf_z, lz = lpf_z;
+    const float ha = hpf_a, hb = hpf_b, la = lpf_a, lb = lpf_b;
+    const float gain = inputGain, clip = clipLevel;
+
+    if (clipper.order() > 0) {
+        // filter, clip and filter again as separate passes over a chunk,
+        // the clip scaled to the shaper's unit range
+        float x[CHUNK];
+        const float drive = gain / clip;
+        while (n > 0) {
+            size_t m = std::min(n, CHUNK);
+            for (size_t i = 0; i < m; ++i) {
+                hz = flushDenormal(ha * (in[i] - hz) + hz * hb);
+                x[i] = hz * drive;
+            }
+            clipper.processBlock(x, x, m);
+            for (size_t i = 0; i < m; ++i) {
+                lz = flushDenormal(la * (x[i] * clip) + lb * lz);
+                out[i] = lz;
+            }
+            in += m; out += m; n -= m;
+        }
+        hpf_z = hz;
+        lpf_z = lz;
+        return;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        hz = flushDenormal(ha * (in[i] - hz) + hz * hb);
+        float x = hz * gain;
+        x = std::min(std::max(x, -clip), clip);
+        lz = flushDenormal(la * x + lb * lz);
+        out[i] = lz;
+    }
+    hpf_z = hz;
+    lpf_z = lz;
+}
+
+
 void Fuzz::reset() {
     hpf_z = lpf_z = 0.0f;
+    clipper.reset();
+}
+
+
+void Fuzz::setParam(int id, float value) {
+    if (id == PARAM_ADAA) clipper.setOrder((int)std::lround(value));
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include "waveshaper.h"
 
 
 class Fuzz {
@@ -6,8 +8,17 @@ public:
     Fuzz();
     void prepare(int sampleRate);
     float process(float in);
+    // process n samples; in and out may alias
+    void processBlock(const float* in, float* out, size_t n);
     void reset();
+
+    // PARAM_ADAA: 0 = plain clip, 1/2 = first/second-order anti-aliased.
+    // Fixed id, shared with AnyEffect::PARAM_ADAA.
+    enum Param { PARAM_ADAA = 32 };
+    void setParam(int id, float value);
 private:
+    static constexpr size_t CHUNK = 128;
+    Waveshaper<HardClip> clipper;
     float inputGain;
     float clipLevel;
     int sampleRate;
@@ -0,0 +1,137 @@
+#include "lfo.h"
+#include "fast_math.h"
+#include <algorithm>
+#include <cmath>
+
+// phase as a signed fraction of a turn in [-0.5, 0.5); the top 24 bits
+// convert to float exactly
+static inline float turns(uint32_t p) {
+    return (float)((int32_t)p >> 8) * (1.0f / 16777216.0f);
+}
+
+static inline float sineAt(uint32_t p) {
+    return fastSin(6.28318530717958647692f * turns(p));
+}
+
+// rises through 0 at p = 0, peaks a quarter turn later
+static inline float triangleAt(uint32_t p) {
+    return 4.0f * std::fabs(turns(p + 0x40000000u)) - 1.0f;
+}
+
+static inline float sawAt(uint32_t p) {
+    return 2.0f * turns(p);
+}
+
+Lfo::Lfo()
+: sampleRate(48000), shape(SINE), rate(1.0f), phase(0), inc(0), offset(0), rng(0x9e3779b9u)
+{
+    held[0] = held[1] = 0.0f;
+    setRate(rate);
+}
+
+void Lfo::prepare(int sr) {
+    sampleRate = sr;
+    setRate(rate);
+    reset();
+}
+
+void Lfo::reset() {
+    phase = 0;
+    held[0] = random();
+    held[1] = random();
+}
+
+void Lfo::setRate(float hz) {
+    rate = std::min(std::max(hz, 0.0f), 0.5f * (float)sampleRate);
+    inc = (uint32_t)std::llround((double)rate / (double)sampleRate * 4294967296.0);
+}
+
+void Lfo::setTempo(float bpm, float beatsPerCycle) {
+    if (bpm <= 0.0f || beatsPerCycle <= 0.0f) return;
+    setRate(bpm / 60.0f / beatsPerCycle);
+}
+
+void Lfo::setStereoOffset(float turnsAhead) {
+    double t = turnsAhead - std::floor(turnsAhead);
+    offset = (uint32_t)std::llround(t * 4294967296.0);
+}
+
+float Lfo::shapeAt(uint32_t p) const {
+    switch (shape) {
+        case TRIANGLE: return triangleAt(p);
+        case SAW:      return sawAt(p);
+        default:       return sineAt(p);
+    }
+}
+
+float Lfo::current(int channel) const {
+    if (shape == SAMPLE_HOLD) return held[channel ? 1 : 0];
+    return shapeAt(phase + (channel ? offset : 0u));
+}
+
+// xorshift32, uniform in [-1, 1)
+float Lfo::random() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return turns(rng) * 2.0f;
+}
+
+// phase from the index rather than accumulated, whole LANES groups then
+// the tail, so the main loop vectorizes
+template <typename F>
+void Lfo::fill(uint32_t start, float* out, size_t n, F f) const {
+    const size_t nv = n & ~(LANES - 1);
+    for (size_t i = 0; i < nv; i += LANES)
+        for (size_t v = 0; v < LANES; ++v)
+            out[i + v] = f(start + inc * (uint32_t)(i + v));
+    for (size_t i = nv; i < n; ++i) out[i] = f(start + inc * (uint32_t)i);
+}
+
+void Lfo::renderFrom(uint32_t start, float* out, size_t n, float& hold) {
+    switch (shape) {
+        case SINE:     fill(start, out, n, sineAt); break;
+        case TRIANGLE: fill(start, out, n, triangleAt); break;
+        case SAW:      fill(start, out, n, sawAt); break;
+        case SAMPLE_HOLD: {
+            // new value whenever the phase wraps
+            uint32_t prev = start - inc;
+            for (size_t i = 0; i < n; ++i) {
+                uint32_t p = start + inc * (uint32_t)i;
+                if (p < prev) hold = random();
+                prev = p;
+                out[i] = hold;
+            }
+            break;
+        }
+    }
+}
+
+void Lfo::render(float* out, size_t n) {
+    renderFrom(phase, out, n, held[0]);
+    phase += inc * (uint32_t)n;
+}
+
+void Lfo::render(float* outL, float* outR, size_t n) {
+    renderFrom(phase, outL, n, held[0]);
+    renderFrom(phase + offset, outR, n, held[1]);
+    phase += inc * (uint32_t)n;
+}
+
+void Lfo::advance(size_t n) {
+    uint64_t step = (uint64_t)inc * n;
+    uint32_t next = phase + (uint32_t)step;
+    if (shape == SAMPLE_HOLD) {
+        bool wrapL = step >= (1ull << 32) || next < phase;
+        bool wrapR = step >= (1ull << 32) || next + offset < phase + offset;
+        if (wrapL) held[0] = random();
+        if (wrapR) held[1] = random();
+    }
+    phase = next;
+}
+
+float Lfo::next() {
+    float v;
+    render(&v, 1);
+    return v;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Phase-accumulator LFO for the modulation effects. The phase is a 32-bit
+// fixed-point fraction of a turn that wraps on its own, so it never loses
+// precision however long it runs (rate resolution is sampleRate / 2^32).
+//
+// Effects render a block of values once per callback with render() and
+// read their delay times or coefficients from that buffer. Output is in
+// [-1, 1]; sine and triangle start at 0 going up, saw rises from 0.
+//
+// The second channel of the stereo render() runs setStereoOffset() turns
+// ahead of the first.
+class Lfo {
+public:
+    enum Shape { SINE, TRIANGLE, SAW, SAMPLE_HOLD };
+
+    Lfo();
+    void prepare(int sampleRate);
+    void reset();
+
+    void setShape(Shape s) { shape = s; }
+    Shape getShape() const { return shape; }
+    void setRate(float hz);
+    // tempo sync: one cycle every beatsPerCycle beats at bpm
+    void setTempo(float bpm, float beatsPerCycle);
+    float getRate() const { return rate; }
+    // 0.25 puts the second channel a quarter cycle ahead
+    void setStereoOffset(float turns);
+
+    // next n values
+    void render(float* out, size_t n);
+    void render(float* outL, float* outR, size_t n);
+    float next();
+
+    // value at the current phase without advancing (channel 1 = offset one),
+    // and skipping ahead, for control-rate users
+    float current(int channel = 0) const;
+    void advance(size_t n);
+
+private:
+    static constexpr size_t LANES = 8;
+
+    template <typename F> void fill(uint32_t start, float* out, size_t n, F f) const;
+    void renderFrom(uint32_t start, float* out, size_t n, float& hold);
+    float shapeAt(uint32_t p) const;
+    float random();
+
+    int sampleRate;
+    Shape shape;
+    float rate;
+    uint32_t phase;          // fraction of a turn, 2^32 = one cycle
+    uint32_t inc;
+    uint32_t offset;         // second channel's lead
+    uint32_t rng;
+    float held[2];           // sample & hold values per channel
+};
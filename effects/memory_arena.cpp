@@ -0,0 +1,56 @@
+#include "memory_arena.h"
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+static const size_t HUGE_PAGE = 2 * 1024 * 1024;
+
+MemoryArena::~MemoryArena() {
+    release();
+}
+
+void MemoryArena::release() {
+    if (!base) return;
+#ifdef __linux__
+    if (mapped) munmap(base, size);
+    else
+#endif
+    ::operator delete(base, std::align_val_t(ALIGN));
+    base = nullptr;
+    size = used = 0;
+    mapped = huge = false;
+}
+
+bool MemoryArena::reserve(size_t bytes) {
+    used = 0;
+    if (bytes <= size) return true;
+    release();
+    if (bytes == 0) return true;
+
+#ifdef __linux__
+    if (bytes >= HUGE_PAGE) {
+        const size_t length = (bytes + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+        void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        huge = p != MAP_FAILED;
+        if (!huge) {
+            p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) return false;
+#ifdef MADV_HUGEPAGE
+            madvise(p, length, MADV_HUGEPAGE);
+#endif
+        }
+        base = (char*)p;
+        size = length;
+        mapped = true;
+        return true;
+    }
+#endif
+
+    base = (char*)::operator new(bytes, std::align_val_t(ALIGN), std::nothrow);
+    if (!base) return false;
+    size = bytes;
+    return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+
+// One block of memory for all the buffers of a graph's effects, so a
+// graph's footprint is a single contiguous allocation, sized up front.
+//
+// Effects that take an arena report memoryRequirement(sampleRate), the
+// bytes their prepare(sampleRate, arena) will take; the owner reserve()s
+// the total, rewind()s and prepares them in turn. Each allocate() is a
+// cache-line aligned span carved off the end of the last one, so
+// re-preparing at the same or a lower rate reuses the block and never
+// reaches the allocator.
+//
+// Blocks of 2 MiB and more are mapped with huge pages where the system
+// has them reserved (MAP_HUGETLB), else asked for transparent huge pages.
+class MemoryArena {
+public:
+    static const size_t ALIGN = 64;
+
+    // arena bytes n Ts take, alignment padding included
+    template <typename T>
+    static size_t bytesFor(size_t n) {
+        return (n * sizeof(T) + ALIGN - 1) & ~(ALIGN - 1);
+    }
+
+    MemoryArena() = default;
+    ~MemoryArena();
+    MemoryArena(const MemoryArena&) = delete;
+    MemoryArena& operator=(const MemoryArena&) = delete;
+
+    // room for at least `bytes`, keeping the current block if it is big
+    // enough and rewinding either way. false if the memory isn't there.
+    bool reserve(size_t bytes);
+    // forgets every span handed out, keeps the block
+    void rewind() { used = 0; }
+
+    // n zeroed Ts, ALIGN-aligned; nullptr if reserve() didn't leave room
+    template <typename T>
+    T* allocate(size_t n) {
+        const size_t bytes = bytesFor<T>(n);
+        if (bytes > size - used) return nullptr;
+        char* p = base + used;
+        used += bytes;
+        std::memset(p, 0, bytes);
+        return reinterpret_cast<T*>(p);
+    }
+
+    // zeroes `bytes` of what has been handed out, from `offset` on
+    void clear(size_t offset, size_t bytes) {
+        if (offset < used) std::memset(base + offset, 0, bytes < used - offset ? bytes : used - offset);
+    }
+
+    size_t capacity() const { return size; }
+    size_t bytesUsed() const { return used; }
+    bool hugePages() const { return huge; }
+
+private:
+    void release();
+
+    char* base = nullptr;
+    size_t size = 0, used = 0;
+    bool mapped = false;      // mmap()ed rather than from operator new
+    bool huge = false;        // MAP_HUGETLB
+};
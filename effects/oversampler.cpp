@@ -0,0 +1,108 @@
+#include "oversampler.h"
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// zeroth-order modified Bessel function, for the Kaiser window
+static double besselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+void HalfBand::prepare(int sideTaps, size_t maxIn) {
+    K = sideTaps < 1 ? 1 : sideTaps;
+    const int L = 2 * K - 1;                 // centre of the filter
+    const double beta = 8.0;                 // Kaiser, roughly 80 dB stopband
+
+    // windowed sinc at the odd offsets -L, -L+2, ..., L; taps[j] multiplies
+    // the sample j steps back
+    taps.assign(2 * K, 0.0f);
+    double sum = 0.0;
+    for (int j = 0; j < 2 * K; ++j) {
+        int off = 2 * j - L;
+        double sinc = std::sin(M_PI * off / 2.0) / (M_PI * off);
+        double r = (double)off / (double)(L + 1);
+        double w = besselI0(beta * std::sqrt(1.0 - r * r)) / besselI0(beta);
+        taps[j] = (float)(sinc * w);
+        sum += sinc * w;
+    }
+    // odd taps sum to one half, so DC gain is exactly one
+    for (float& t : taps) t = (float)(t * 0.5 / sum);
+
+    const size_t slack = LANES;
+    hist.assign(L + maxIn + slack, 0.0f);
+    oddHist.assign(K + maxIn, 0.0f);
+}
+
+void HalfBand::reset() {
+    std::fill(hist.begin(), hist.end(), 0.0f);
+    std::fill(oddHist.begin(), oddHist.end(), 0.0f);
+}
+
+void HalfBand::upsample(const float* in, float* out, size_t n) {
+    const size_t H = 2 * K - 1;
+    float* x = hist.data() + H;
+    std::copy(in, in + n, x);
+
+    // even outputs: the odd taps over the input history. The sums live in
+    // a local array so the compiler knows they don't alias the history.
+    float a[BLOCK];
+    for (size_t b = 0; b < n; b += BLOCK) {
+        const size_t m = std::min(BLOCK, n - b);
+        const size_t mv = (m + LANES - 1) & ~(LANES - 1);
+        std::fill(a, a + mv, 0.0f);
+        for (int j = 0; j < 2 * K; ++j) {
+            const float t = 2.0f * taps[j];      // zero stuffing halves the gain
+            const float* xj = x + b - j;
+            for (size_t i = 0; i < mv; i += LANES)
+                for (size_t v = 0; v < LANES; ++v) a[i + v] += t * xj[i + v];
+        }
+
+        // odd outputs: the centre tap, a pure delay
+        const float* centre = x + b - (K - 1);
+        float* o = out + 2 * b;
+        for (size_t i = 0; i < m; ++i) {
+            o[2 * i] = a[i];
+            o[2 * i + 1] = centre[i];
+        }
+    }
+
+    std::copy(hist.begin() + n, hist.begin() + n + H, hist.begin());
+}
+
+void HalfBand::downsample(const float* in, float* out, size_t n) {
+    const size_t H = 2 * K - 1;
+    float* e = hist.data() + H;
+    float* o = oddHist.data() + K;
+    for (size_t i = 0; i < n; ++i) {
+        e[i] = in[2 * i];
+        o[i] = in[2 * i + 1];
+    }
+
+    float a[BLOCK];
+    for (size_t b = 0; b < n; b += BLOCK) {
+        const size_t m = std::min(BLOCK, n - b);
+        const size_t mv = (m + LANES - 1) & ~(LANES - 1);
+        std::fill(a, a + mv, 0.0f);
+        for (int j = 0; j < 2 * K; ++j) {
+            const float t = taps[j];
+            const float* ej = e + b - j;
+            for (size_t i = 0; i < mv; i += LANES)
+                for (size_t v = 0; v < LANES; ++v) a[i + v] += t * ej[i + v];
+        }
+
+        // centre tap lands on the odd phase, K samples back
+        const float* centre = oddHist.data() + b;
+        for (size_t i = 0; i < m; ++i) out[b + i] = a[i] + 0.5f * centre[i];
+    }
+
+    std::copy(hist.begin() + n, hist.begin() + n + H, hist.begin());
+    std::copy(oddHist.begin() + n, oddHist.begin() + n + K, oddHist.begin());
+}
@@ -0,0 +1,176 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include "tail.h"
+
+// Linear-phase half-band FIR that doubles or halves the rate, polyphase: the
+// zero taps are skipped and the centre tap is a plain delay, so only the
+// 2*sideTaps odd taps are multiplied. Filters run tap by tap across the whole
+// block in fixed groups of LANES, which vectorizes at -O2.
+//
+// One instance is either an upsampler or a downsampler; it keeps that
+// direction's history.
+class HalfBand {
+public:
+    // sideTaps odd taps each side of the centre (filter length 4*sideTaps - 1);
+    // maxIn is the largest n passed to upsample()/downsample()
+    void prepare(int sideTaps, size_t maxIn);
+    void reset();
+
+    // n samples in, 2n out
+    void upsample(const float* in, float* out, size_t n);
+    // 2n samples in, n out
+    void downsample(const float* in, float* out, size_t n);
+
+    // group delay in samples at the higher rate
+    int latency() const { return 2 * K - 1; }
+
+private:
+    static constexpr size_t LANES = 8;
+    static constexpr size_t BLOCK = 256;    // filtered per pass
+
+    int K = 0;
+    std::vector<float> taps;         // 2K odd taps, newest sample first
+    std::vector<float> hist;         // up: input;  down: even phase
+    std::vector<float> oddHist;      // down: odd phase
+};
+
+// Runs any effects/ class at 1x, 2x, 4x or 8x the host rate, picked at run
+// time, through cascaded half-band stages. Every factor's filters are
+// allocated in prepare(), so setFactor() only re-runs E::prepare() at the
+// new rate; that's realtime safe for effects whose prepare() doesn't
+// allocate (Fuzz, Exciter, Bitcrusher).
+template <typename E>
+class Oversampled {
+public:
+    static const int MAX_FACTOR = 8;
+    // id for setParam(); the effect's own ids pass through
+    enum { PARAM_FACTOR = 64 };
+
+    void prepare(int sampleRate) {
+        baseRate = sampleRate;
+        for (int s = 0; s < STAGES; ++s) {
+            up[s].prepare(SIDE_TAPS[s], CHUNK << s);
+            down[s].prepare(SIDE_TAPS[s], CHUNK << s);
+        }
+        for (auto& b : buf) b.assign(CHUNK * MAX_FACTOR, 0.0f);
+        fx.prepare(baseRate * factor);
+    }
+
+    float process(float in) {
+        float out;
+        processBlock(&in, &out, 1);
+        return out;
+    }
+
+    // process n samples; in and out may alias
+    void processBlock(const float* in, float* out, size_t n) {
+        if (factor == 1 || buf[0].empty()) {
+            fx.processBlock(in, out, n);
+            return;
+        }
+        const int stages = stageCount();
+        while (n > 0) {
+            const size_t m = std::min(n, CHUNK);
+            const float* src = in;
+            size_t len = m;
+            for (int s = 0; s < stages; ++s) {
+                up[s].upsample(src, buf[s & 1].data(), len);
+                src = buf[s & 1].data();
+                len *= 2;
+            }
+            float* work = buf[(stages - 1) & 1].data();
+            fx.processBlock(work, work, len);
+            for (int s = stages - 1; s >= 0; --s) {
+                len /= 2;
+                float* dst = s == 0 ? out : buf[(s - 1) & 1].data();
+                down[s].downsample(work, dst, len);
+                work = dst;
+            }
+            in += m; out += m; n -= m;
+        }
+    }
+
+    void reset() {
+        for (int s = 0; s < STAGES; ++s) { up[s].reset(); down[s].reset(); }
+        fx.reset();
+    }
+
+    // 1, 2, 4 or 8; anything else rounds down to one of those
+    void setFactor(int f) {
+        int nf = f >= 8 ? 8 : f >= 4 ? 4 : f >= 2 ? 2 : 1;
+        if (nf == factor) return;
+        factor = nf;
+        for (int s = 0; s < STAGES; ++s) { up[s].reset(); down[s].reset(); }
+        if (!buf[0].empty()) fx.prepare(baseRate * factor);
+    }
+    int getFactor() const { return factor; }
+
+    // round-trip delay of the filters, plus the effect's own, in host-rate
+    // samples
+    float latencySamples() const {
+        if constexpr (HasLatency<E>::value)
+            return latencyFor(factor) + fx.latencySamples() / (float)factor;
+        return latencyFor(factor);
+    }
+    static float latencyFor(int f) {
+        float total = 0.0f;
+        for (int s = 0, r = 2; r <= f; ++s, r *= 2)
+            total += 2.0f * (float)(2 * SIDE_TAPS[s] - 1) / (float)r;
+        return total;
+    }
+
+    // the effect's own tail, in host samples, behind the filters
+    size_t tailSamples() const {
+        const size_t filters = (size_t)std::ceil(latencySamples());
+        if constexpr (HasTail<E>::value) {
+            const size_t inner = fx.tailSamples();
+            return inner == ENDLESS_TAIL ? ENDLESS_TAIL : inner / (size_t)factor + filters;
+        }
+        return filters;
+    }
+
+    void setParam(int id, float value) {
+        if (id == PARAM_FACTOR) setFactor((int)value);
+        else if constexpr (HasSetParam<E>::value) fx.setParam(id, value);
+    }
+
+    E& effect() { return fx; }
+
+private:
+    static constexpr int STAGES = 3;
+    static constexpr size_t CHUNK = 256;
+    // the first stage guards the host band; later ones only need to reject
+    // images far above it, so they get shorter
+    static constexpr int SIDE_TAPS[STAGES] = { 12, 6, 4 };
+
+    template <typename T, typename = void>
+    struct HasSetParam : std::false_type {};
+    template <typename T>
+    struct HasSetParam<T, std::void_t<decltype(std::declval<T&>().setParam(0, 0.0f))>>
+        : std::true_type {};
+
+    template <typename T, typename = void>
+    struct HasLatency : std::false_type {};
+    template <typename T>
+    struct HasLatency<T, std::void_t<decltype(std::declval<const T&>().latencySamples())>>
+        : std::true_type {};
+
+    template <typename T, typename = void>
+    struct HasTail : std::false_type {};
+    template <typename T>
+    struct HasTail<T, std::void_t<decltype(std::declval<const T&>().tailSamples())>>
+        : std::true_type {};
+
+    int stageCount() const { return factor == 8 ? 3 : factor == 4 ? 2 : 1; }
+
+    E fx;
+    int baseRate = 48000;
+    int factor = 1;
+    HalfBand up[STAGES], down[STAGES];
+    std::vector<float> buf[2];       // ping-pong between stages
+};
@@ -1,43 +1,63 @@
 #include "phaser.h"
+#include <algorithm>
 
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
+Phaser::Phaser() : baseDelay(0.0f), depth(0.0f) {
+    lfo.setRate(0.3f);
+}
 
-Phaser::Phaser() : lfoPhase(0.0f), lfoInc(0.0f), baseDelay(0.0f), depth(0.0f), writeIndex(0) {}
+// 20 ms delay buffer
+static size_t maxDelay(int sampleRate) {
+    return size_t(sampleRate * 0.02f);
+}
 
-void Phaser::prepare(int sampleRate) {
-    buffer.assign(sampleRate * 0.02f, 0.0f);   // 20 ms delay buffer
-    writeIndex = 0;
+size_t Phaser::memoryRequirement(int sampleRate) const {
+    return DelayLine<Interp::Linear>::memoryRequirement(maxDelay(sampleRate), CHUNK);
+}
+
+void Phaser::prepare(int sampleRate, MemoryArena* arena) {
+    line.prepare(maxDelay(sampleRate), CHUNK, arena);
 
     baseDelay = 0.002f * sampleRate;          // 2 ms
     depth     = 0.0015f * sampleRate;         // ±1.5 ms
-
-    float lfoRate = 0.3f;                     // Hz
-    lfoInc = (2.0f * M_PI * lfoRate) / sampleRate;
+    lfo.prepare(sampleRate);
 }
 
 float Phaser::process(float in) {
-    if (buffer.empty()) return in;
+    if (line.capacity() == 0) return in;
+
+    float mod = baseDelay + lfo.next() * depth;
+
+    line.push(in);
+    float delayed = line.read(mod);
+
+    return 0.5f * (in + delayed);
+}
+
+void Phaser::processBlock(const float* in, float* out, size_t n) {
+    if (line.capacity() == 0) {
+        if (out != in) std::copy(in, in + n, out);
+        return;
+    }
 
-    float mod = baseDelay + std::sin(lfoPhase) * depth;
-    lfoPhase += lfoInc;
-    if (lfoPhase >= 2.0f * M_PI) lfoPhase -= 2.0f * M_PI;
+    float delays[CHUNK];
+    float delayed[CHUNK];
 
-    int readIndex = writeIndex - static_cast<int>(mod);
-    while (readIndex < 0) readIndex += buffer.size();
+    while (n > 0) {
+        size_t m = std::min(n, CHUNK);
 
-    float delayed = buffer[readIndex];
-    float out = 0.5f * (in + delayed);
+        lfo.render(delays, m);
+        for (size_t i = 0; i < m; ++i) delays[i] = baseDelay + delays[i] * depth;
 
-    buffer[writeIndex] = in;
-    writeIndex = (writeIndex + 1) % buffer.size();
+        line.writeBlock(in, m);
+        line.readBlock(delays, delayed, m);
+        for (size_t i = 0; i < m; ++i)
+            out[i] = 0.5f * (in[i] + delayed[i]);
 
-    return out;
+        in += m; out += m; n -= m;
+    }
 }
 
 void Phaser::reset() {
-    std::fill(buffer.begin(), buffer.end(), 0.0f);
-    writeIndex = 0;
-    lfoPhase = 0.0f;
+    line.clear();
+    lfo.reset();
 }
@@ -1,20 +1,30 @@
 #pragma once
 #include <vector>
 #include <cmath>
+#include <cstddef>
+#include "delay_line.h"
+#include "lfo.h"
 
 class Phaser {
 public:
     Phaser();
-    void prepare(int sampleRate);
+    // arena bytes prepare(sampleRate, arena) takes
+    size_t memoryRequirement(int sampleRate) const;
+    // delay line from the arena if one is given, else allocated
+    void prepare(int sampleRate, MemoryArena* arena = nullptr);
     float process(float in);
+    // process n samples; in and out may alias
+    void processBlock(const float* in, float* out, size_t n);
     void reset();
+    // samples it rings for once the input stops: the longest read delay
+    size_t tailSamples() const { return (size_t)(baseDelay + depth) + 2; }
 
 private:
-    float lfoPhase;
-    float lfoInc;
+    static constexpr size_t CHUNK = 256;
+
+    Lfo lfo;
     float baseDelay;
     float depth;
 
-    std::vector<float> buffer;
-    int writeIndex;
+    DelayLine<Interp::Linear> line;
 };
@@ -1,4 +1,7 @@
 #include "pingpong_delay.h"
+#include "denormal.h"
+#include "fast_math.h"
+#include "tail.h"
 #include <vector>
 #include <cmath>
 #include <algorithm>
@@ -17,57 +20,138 @@ constexpr float FEEDBACK = 0.45f;
 
 
 PingPongDelay::PingPongDelay()
-: sampleRate(48000), writePos(0), delaySamplesL(1), delaySamplesR(1), fbLowpass_z(0.0f), fbLowpass_a0(1.0f), fbLowpass_b1(0.0f)
+: sampleRate(48000), delaySamplesL(1), delaySamplesR(1), tapSamplesL(1), tapSamplesR(1), fbLowpass_zL(0.0f), fbLowpass_zR(0.0f), fbLowpass_a0(1.0f), fbLowpass_b1(0.0f)
 { }
 
 
-void PingPongDelay::prepare(int sr) {
-    sampleRate = sr;
-    size_t maxSamples = (size_t)(sampleRate * 2.0f) + 10;
-    bufL.assign(maxSamples, 0.0f);
-    bufR.assign(maxSamples, 0.0f);
-    writePos = 0;
-    delaySamplesL = (int)std::round(DEFAULT_DELAY_MS_L * 0.001f * sampleRate);
-    delaySamplesR = (int)std::round(DEFAULT_DELAY_MS_R * 0.001f * sampleRate);
+// up to 2 s per side
+static size_t maxSamples(int sr) {
+    return (size_t)(sr * 2.0f) + 10;
+}
+
+size_t PingPongDelay::memoryRequirement(int sr) const {
+    return 2 * DelayLine<Interp::None>::memoryRequirement(maxSamples(DecimatedPath::rateFor(sr, decimate)));
+}
+
+void PingPongDelay::prepare(int sr, MemoryArena* arena) {
+    // everything below runs at the divided rate
+    sampleRate = DecimatedPath::rateFor(sr, decimate);
+    path.prepare(decimate, 2);
+    lineL.prepare(maxSamples(sampleRate), 0, arena);
+    lineR.prepare(maxSamples(sampleRate), 0, arena);
+    delaySamplesL = std::max(1, (int)std::round(DEFAULT_DELAY_MS_L * 0.001f * sampleRate));
+    delaySamplesR = std::max(1, (int)std::round(DEFAULT_DELAY_MS_R * 0.001f * sampleRate));
+    const int filterDelay = (int)std::round(path.latencySamples() / (float)decimate);
+    tapSamplesL = std::max(1, delaySamplesL - filterDelay);
+    tapSamplesR = std::max(1, delaySamplesR - filterDelay);
     fbLowpass_setCutoff(6000.0f);
 }
 
 
+void PingPongDelay::setParam(int id, float value) {
+    if (id == PARAM_DECIMATE) setDecimation((int)value);
+}
+
+
+// each echo crosses to the other side a FEEDBACK quieter
+size_t PingPongDelay::tailSamples() const {
+    const size_t tail = feedbackTail((float)std::max(delaySamplesL, delaySamplesR), FEEDBACK);
+    return tail * (size_t)decimate + (decimate > 1 ? (size_t)std::ceil(path.latencySamples()) : 0);
+}
+
+
 void PingPongDelay::fbLowpass_setCutoff(float fc) {
-    float x = expf(-2.0f * M_PI * fc / sampleRate);
+    float x = fastExp(-2.0f * M_PI * fc / sampleRate);
     fbLowpass_b1 = x;
     fbLowpass_a0 = 1.0f - x;
 }
 
 
-float PingPongDelay::fbLowpass_process(float in) {
-    float y = fbLowpass_a0 * in + fbLowpass_b1 * fbLowpass_z;
-    fbLowpass_z = y;
+float PingPongDelay::fbLowpass_process(float in, float& z) {
+    float y = flushDenormal(fbLowpass_a0 * in + fbLowpass_b1 * z);
+    z = y;
     return y;
 }
 
 
 void PingPongDelay::process(float in, float &outL, float &outR) {
-    size_t N = bufL.size();
-    int readPosL = (int)writePos - delaySamplesL;
-    int readPosR = (int)writePos - delaySamplesR;
-    while (readPosL < 0) readPosL += (int)N;
-    while (readPosR < 0) readPosR += (int)N;
-    float delayedL = bufL[readPosL];
-    float delayedR = bufR[readPosR];
+    if (decimate > 1) {
+        processBlock(&in, &outL, &outR, 1);
+        return;
+    }
+    float delayedL = lineL.at(delaySamplesL - 1);
+    float delayedR = lineR.at(delaySamplesR - 1);
     outL = DRY_GAIN * in + WET_GAIN * delayedL;
     outR = DRY_GAIN * in + WET_GAIN * delayedR;
-    float fbToL = fbLowpass_process(delayedR * FEEDBACK);
-    float fbToR = fbLowpass_process(delayedL * FEEDBACK);
-    bufL[writePos] = in + fbToL;
-    bufR[writePos] = in + fbToR;
-    writePos = (writePos + 1) % N;
+    float fbToL = fbLowpass_process(delayedR * FEEDBACK, fbLowpass_zL);
+    float fbToR = fbLowpass_process(delayedL * FEEDBACK, fbLowpass_zR);
+    lineL.push(in + fbToL);
+    lineR.push(in + fbToR);
+}
+
+
+void PingPongDelay::wetBlock(const float* in, float* oL, float* oR, size_t n) {
+    // Both delays are longer than a chunk, so a chunk's taps all come from
+    // samples written before it: read the whole chunk, then write it back.
+    const size_t maxChunk = std::min<size_t>(CHUNK, std::min(tapSamplesL, tapSamplesR));
+    float dL[CHUNK], dR[CHUNK], wL[CHUNK], wR[CHUNK];
+    float zL = fbLowpass_zL, zR = fbLowpass_zR;
+    const float a0 = fbLowpass_a0, b1 = fbLowpass_b1;
+
+    while (n > 0) {
+        size_t m = std::min(n, maxChunk);
+        for (size_t i = 0; i < m; ++i) {
+            dL[i] = lineL.at(delaySamplesL - 1 - i);
+            dR[i] = lineR.at(delaySamplesR - 1 - i);
+            oL[i] = lineL.at(tapSamplesL - 1 - i);
+            oR[i] = lineR.at(tapSamplesR - 1 - i);
+        }
+        for (size_t i = 0; i < m; ++i) {
+            zL = flushDenormal(a0 * (dR[i] * FEEDBACK) + b1 * zL);
+            zR = flushDenormal(a0 * (dL[i] * FEEDBACK) + b1 * zR);
+            wL[i] = in[i] + zL;
+            wR[i] = in[i] + zR;
+        }
+        lineL.writeBlock(wL, m);
+        lineR.writeBlock(wR, m);
+        in += m; oL += m; oR += m; n -= m;
+    }
+    fbLowpass_zL = zL;
+    fbLowpass_zR = zR;
+}
+
+
+void PingPongDelay::processBlock(const float* in, float* outL, float* outR, size_t n) {
+    float dL[CHUNK], dR[CHUNK];
+    while (n > 0) {
+        size_t m = std::min(n, CHUNK);
+        if (decimate > 1) {
+            path.process(in, dL, dR, m, [this](const float* x, float* l, float* r, size_t k) {
+                wetBlock(x, l, r, k);
+            });
+        } else {
+            wetBlock(in, dL, dR, m);
+        }
+        for (size_t i = 0; i < m; ++i) {
+            float d = DRY_GAIN * in[i];
+            outL[i] = d + WET_GAIN * dL[i];
+            outR[i] = d + WET_GAIN * dR[i];
+        }
+        in += m; outL += m; outR += m; n -= m;
+    }
 }
 
 
 void PingPongDelay::reset() {
-    std::fill(bufL.begin(), bufL.end(), 0.0f);
-    std::fill(bufR.begin(), bufR.end(), 0.0f);
-    writePos = 0;
-    fbLowpass_z = 0.0f;
+    lineL.clear();
+    lineR.clear();
+    fbLowpass_zL = fbLowpass_zR = 0.0f;
+    path.reset();
+}
+
+void PingPongDelay::resetState() {
+    lineL.clearState();
+    lineR.clearState();
+    fbLowpass_zL = fbLowpass_zR = 0.0f;
+    path.reset();
 }
\ No newline at end of file
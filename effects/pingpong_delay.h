@@ -1,20 +1,48 @@
 #pragma once
 #include <vector>
+#include <cstddef>
+#include "delay_line.h"
+#include "decimated_path.h"
 
 class PingPongDelay {
 public:
     PingPongDelay();
-    void prepare(int sampleRate);
+    // arena bytes prepare(sampleRate, arena) takes
+    size_t memoryRequirement(int sampleRate) const;
+    // delay lines from the arena if one is given, else allocated
+    void prepare(int sampleRate, MemoryArena* arena = nullptr);
     // process mono input -> stereo output
     void process(float in, float &outL, float &outR);
+    // block version, planar stereo out; in may alias outL or outR
+    void processBlock(const float* in, float* outL, float* outR, size_t n);
     void reset();
+    // reset() without clearing the delay lines, for an owner that has
+    // zeroed the arena they are in
+    void resetState();
+
+    // runs the delay lines and feedback at 1/2 or 1/4 of the rate (dry
+    // path untouched), for half or a quarter of their memory and work. The
+    // output taps sit the resampling filters' delay ahead of the feedback
+    // taps, so the echoes stay put. Takes effect at the next prepare().
+    void setDecimation(int factor) { decimate = DecimatedPath::roundFactor(factor); }
+    int getDecimation() const { return decimate; }
+    // host samples it rings for once the input stops (tail.h)
+    size_t tailSamples() const;
+
+    enum Param { PARAM_DECIMATE = 96 };
+    void setParam(int id, float value);
 private:
+    static constexpr size_t CHUNK = 256;
+    // delayed signal for n samples, lines and feedback updated
+    void wetBlock(const float* in, float* oL, float* oR, size_t n);
+    int decimate = 1;
+    DecimatedPath path;
     int sampleRate;
-    std::vector<float> bufL, bufR;
-    size_t writePos;
-    int delaySamplesL, delaySamplesR;
-    float fbLowpass_z;
+    DelayLine<Interp::None> lineL, lineR;
+    int delaySamplesL, delaySamplesR;     // feedback taps
+    int tapSamplesL, tapSamplesR;         // output taps, earlier when decimated
+    float fbLowpass_zL, fbLowpass_zR;     // one state per side
     float fbLowpass_a0, fbLowpass_b1;
     void fbLowpass_setCutoff(float fc);
-    float fbLowpass_process(float in);
+    float fbLowpass_process(float in, float& z);
 };
\ No newline at end of file
@@ -0,0 +1,281 @@
+#include "pipelined_graph.h"
+#include <algorithm>
+
+#include "denormal.h"
+#include "rt_sanitizer.h"
+#include "worker_wait.h"
+
+// top-level serial items of a spec that already compiled
+static std::vector<std::string> splitSerial(const std::string& spec) {
+    std::vector<std::string> items;
+    int depth = 0;
+    size_t start = 0;
+    for (size_t i = 0; i <= spec.size(); ++i) {
+        char c = i < spec.size() ? spec[i] : '>';
+        if (c == '[') ++depth;
+        else if (c == ']') --depth;
+        else if (c == '>' && depth == 0) {
+            items.push_back(spec.substr(start, i - start));
+            start = i + 1;
+        }
+    }
+    return items;
+}
+
+// smallest number of contiguous groups (at most maxGroups) that gets the
+// heaviest group as light as possible; returns each group's first item
+static std::vector<size_t> partition(const std::vector<float>& cost, size_t maxGroups,
+                                     float& heaviest) {
+    const size_t n = cost.size();
+    std::vector<float> prefix(n + 1, 0.0f);
+    for (size_t i = 0; i < n; ++i) prefix[i + 1] = prefix[i] + cost[i];
+
+    // best[k][i]: lightest heaviest-group for the first i items in k + 1 groups
+    maxGroups = std::max<size_t>(1, std::min(maxGroups, n));
+    std::vector<std::vector<float>> best(maxGroups, std::vector<float>(n + 1, 0.0f));
+    std::vector<std::vector<size_t>> cut(maxGroups, std::vector<size_t>(n + 1, 0));
+    for (size_t i = 0; i <= n; ++i) best[0][i] = prefix[i];
+    for (size_t k = 1; k < maxGroups; ++k) {
+        for (size_t i = 0; i <= n; ++i) {
+            best[k][i] = best[k - 1][i];
+            cut[k][i] = i;
+            for (size_t j = 1; j < i; ++j) {
+                float v = std::max(best[k - 1][j], prefix[i] - prefix[j]);
+                if (v < best[k][i]) { best[k][i] = v; cut[k][i] = j; }
+            }
+        }
+    }
+
+    size_t k = 0;
+    while (best[k][n] > best[maxGroups - 1][n] * 1.0001f) ++k;
+    heaviest = best[k][n];
+
+    std::vector<size_t> starts;
+    for (size_t i = n; k > 0; --k) {
+        if (cut[k][i] == i) continue;     // no better with this many groups
+        i = cut[k][i];
+        starts.push_back(i);
+    }
+    starts.push_back(0);
+    std::reverse(starts.begin(), starts.end());
+    return starts;
+}
+
+PipelinedGraph::~PipelinedGraph() {
+    stop();
+}
+
+// ------------------ Build ------------------------------
+bool PipelinedGraph::build(const std::string& spec, int threads, std::string& error) {
+    stop();
+    stages.clear();
+    nodeStage.clear();
+    nodeLocal.clear();
+
+    // errors are reported against the whole spec
+    EffectGraph whole;
+    if (!whole.build(spec, error)) return false;
+
+    // cost of each top-level item, in the channel layout it will see
+    std::vector<std::string> items = splitSerial(spec);
+    std::vector<float> cost;
+    bool stereo = false;
+    for (const std::string& item : items) {
+        EffectGraph g;
+        if (!g.build(item, error, stereo)) return false;
+        cost.push_back(g.cost());
+        stereo = g.stereoOutput();
+    }
+
+    float total = 0.0f;
+    for (float c : cost) total += c;
+    float heaviest = total;
+    std::vector<size_t> starts = partition(cost, threads > 1 ? (size_t)threads : 1, heaviest);
+    if (total < LIGHT_COST || heaviest * MIN_SPEEDUP > total) starts.assign(1, 0);
+
+    stereo = false;
+    for (size_t g = 0; g < starts.size(); ++g) {
+        size_t end = g + 1 < starts.size() ? starts[g + 1] : items.size();
+        std::string sub = items[starts[g]];
+        for (size_t i = starts[g] + 1; i < end; ++i) sub += ">" + items[i];
+
+        std::unique_ptr<Stage> stage(new Stage());
+        if (!stage->graph.build(sub, error, stereo)) {
+            stages.clear();
+            return false;
+        }
+        stereo = stage->graph.stereoOutput();
+        for (size_t i = 0; i < stage->graph.size(); ++i) {
+            nodeStage.push_back((int)g);
+            nodeLocal.push_back((int)i);
+        }
+        stages.push_back(std::move(stage));
+    }
+    return true;
+}
+
+// ------------------ Setup -----------------------------
+void PipelinedGraph::prepare(int sampleRate, size_t blockPeriod, int audioCore) {
+    stop();
+    period = std::max<size_t>(1, blockPeriod);
+    subLen = std::max(SUB_BLOCK, (period + MAX_SUBS - 1) / MAX_SUBS);
+    subs = (period + subLen - 1) / subLen;
+
+    for (auto& st : stages) {
+        st->graph.prepare(sampleRate, threaded() ? subLen : period);
+        int j;
+        while (st->todo.pop(j)) {}
+    }
+
+    pendIn.assign(period, 0.0f);
+    jobIn.assign(period, 0.0f);
+    bufL.assign(period, 0.0f);
+    bufR.assign(period, 0.0f);
+    readyL.assign(period, 0.0f);
+    readyR.assign(period, 0.0f);
+    fill = 0;
+    inFlight = false;
+    done.store(0);
+    late.store(0);
+
+    if (!threaded()) return;
+    // the audio callback's core is left to it
+    unsigned cores = std::thread::hardware_concurrency();
+    running.store(true);
+    for (size_t s = 0; s < stages.size(); ++s) {
+        stages[s]->worker = std::thread(&PipelinedGraph::work, this, s);
+        if (cores > 1) pinToCore(stages[s]->worker, workerCore(s, audioCore, cores));
+        raisePriority(stages[s]->worker);
+    }
+}
+
+void PipelinedGraph::stop() {
+    running.store(false);
+    for (auto& st : stages)
+        if (st->worker.joinable()) st->worker.join();
+}
+
+void PipelinedGraph::reset() {
+    int spins = 0;
+    if (inFlight)
+        while (done.load(std::memory_order_acquire) != subs) busyWait(spins);
+    for (auto& st : stages) st->graph.reset();
+    std::fill(pendIn.begin(), pendIn.end(), 0.0f);
+    std::fill(readyL.begin(), readyL.end(), 0.0f);
+    std::fill(readyR.begin(), readyR.end(), 0.0f);
+    fill = 0;
+    inFlight = false;
+}
+
+const std::string& PipelinedGraph::nodeName(size_t index) const {
+    return stages[nodeStage[index]]->graph.nodeName((size_t)nodeLocal[index]);
+}
+
+void PipelinedGraph::setImpulse(const float* ir, size_t length, int sampleRate) {
+    for (auto& st : stages) st->graph.setImpulse(ir, length, sampleRate);
+}
+
+void PipelinedGraph::setSilenceFloor(float db) {
+    for (auto& st : stages) st->graph.setSilenceFloor(db);
+}
+
+float PipelinedGraph::latencySamples() const {
+    float lat = threaded() ? (float)period : 0.0f;
+    for (const auto& st : stages) lat += st->graph.latencySamples();
+    return lat;
+}
+
+// ------------------ Commands --------------------------
+void PipelinedGraph::setEnabled(size_t index, bool on) {
+    apply(EffectCommand::enable((int)index, on));
+}
+
+void PipelinedGraph::setParam(size_t index, int param, float value) {
+    apply(EffectCommand::setParam((int)index, param, value));
+}
+
+void PipelinedGraph::apply(const EffectCommand& cmd) {
+    if (cmd.effect < 0 || (size_t)cmd.effect >= nodeStage.size()) return;
+    Stage& st = *stages[nodeStage[cmd.effect]];
+    EffectCommand local = cmd;
+    local.effect = nodeLocal[cmd.effect];
+    // a full queue drops the command, as the controller's own queue does
+    if (running.load(std::memory_order_relaxed)) st.commands.push(local);
+    else st.graph.apply(local);
+}
+
+// ------------------ Processing ------------------------
+void PipelinedGraph::processBlock(const float* in, float* outL, float* outR, size_t n) {
+    if (!threaded()) {
+        stages[0]->graph.processBlock(in, outL, outR, n);
+        return;
+    }
+
+    // the previous period is collected when its output is first needed and
+    // the next one started as soon as its input is complete, so with periods
+    // lined up with callbacks the pipeline gets a whole callback to run
+    while (n > 0) {
+        if (fill == 0 && inFlight) finishBlock();
+        const size_t m = std::min(n, period - fill);
+        // in first: it may alias outL
+        std::copy(in, in + m, pendIn.begin() + fill);
+        std::copy(readyL.begin() + fill, readyL.begin() + fill + m, outL);
+        std::copy(readyR.begin() + fill, readyR.begin() + fill + m, outR);
+        fill += m;
+        if (fill == period) {
+            startBlock();
+            fill = 0;
+        }
+        in += m; outL += m; outR += m; n -= m;
+    }
+}
+
+void PipelinedGraph::finishBlock() {
+    if (done.load(std::memory_order_acquire) != subs) {
+        late.fetch_add(1, std::memory_order_relaxed);
+        int spins = 0;
+        while (done.load(std::memory_order_acquire) != subs) busyWait(spins);
+    }
+    std::copy(bufL.begin(), bufL.end(), readyL.begin());
+    std::copy(bufR.begin(), bufR.end(), readyR.begin());
+    inFlight = false;
+}
+
+void PipelinedGraph::startBlock() {
+    std::copy(pendIn.begin(), pendIn.end(), jobIn.begin());
+    done.store(0, std::memory_order_relaxed);
+    for (size_t j = 0; j < subs; ++j) stages[0]->todo.push((int)j);
+    inFlight = true;
+}
+
+void PipelinedGraph::work(size_t s) {
+    Stage& st = *stages[s];
+    Stage* next = s + 1 < stages.size() ? stages[s + 1].get() : nullptr;
+    int spins = 0;
+
+    while (running.load(std::memory_order_acquire)) {
+        int j;
+        if (!st.todo.pop(j)) {
+            idleWait(spins);
+            continue;
+        }
+        spins = 0;
+        ScopedRealtime rt;    // on the callback's deadline from here
+        ScopedFlushDenormals flush;
+
+        if (j == 0) {
+            EffectCommand c;
+            while (st.commands.pop(c)) st.graph.apply(c);
+        }
+
+        const size_t start = (size_t)j * subLen;
+        const size_t m = std::min(subLen, period - start);
+        float* L = bufL.data() + start;
+        float* R = bufR.data() + start;
+        if (s == 0) st.graph.processBlock(jobIn.data() + start, L, R, m);
+        else st.graph.processBlock(L, R, L, R, m);
+
+        if (next) next->todo.push(j);
+        else done.fetch_add(1, std::memory_order_release);
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "effect_command.h"
+#include "effect_graph.h"
+#include "spsc_queue.h"
+
+// An EffectGraph spread over worker threads as a pipeline, for graphs too
+// heavy for one core.
+//
+// The spec's top-level serial items ("a > [b | c] > d" has three) are
+// grouped into at most `threads` contiguous stages of about equal
+// AnyEffect::cost(). Each stage is an EffectGraph run by its own worker,
+// pinned to a core where the OS allows it.
+//
+// processBlock() collects `period` samples, hands them to the first stage
+// and returns the previous period's output, so the pipeline adds exactly
+// one period of latency and has one period to finish (provided periods
+// start where callbacks do). Within it the block moves through the stages
+// a sub-block at a time, stage s+1 working on sub-block j while stage s
+// works on j+1, so the wall time approaches the heaviest stage rather than
+// the whole graph.
+//
+// A light graph (under LIGHT_COST in total, or one that can't be split
+// into stages at least MIN_SPEEDUP faster) or threads <= 1 runs inline on
+// the caller's thread like a plain EffectGraph, with no added latency. The
+// choice depends only on the spec and thread count.
+//
+// Threaded, commands reach each stage through its own queue and apply at
+// the start of the next block it processes, i.e. quantized to the period.
+class PipelinedGraph {
+public:
+    static constexpr float LIGHT_COST = 40.0f;    // ns/sample, about 2% of one core
+    static constexpr float MIN_SPEEDUP = 1.25f;
+    static constexpr size_t SUB_BLOCK = 32;       // frames per pipeline step
+
+    PipelinedGraph() = default;
+    ~PipelinedGraph();
+    PipelinedGraph(const PipelinedGraph&) = delete;
+    PipelinedGraph& operator=(const PipelinedGraph&) = delete;
+
+    // false and a message for a malformed spec or unknown effect
+    bool build(const std::string& spec, int threads, std::string& error);
+    // allocates and starts the workers. period is the block the pipeline
+    // runs on (the audio callback's size) and, threaded, its latency;
+    // audioCore is the callback's core, which the workers keep off.
+    void prepare(int sampleRate, size_t period, int audioCore = 0);
+    // not while processBlock() may be running
+    void reset();
+
+    size_t size() const { return nodeStage.size(); }
+    const std::string& nodeName(size_t index) const;
+    // impulse response for every cabinet node; before prepare()
+    void setImpulse(const float* ir, size_t length, int sampleRate);
+    // EffectGraph::setSilenceFloor() for every stage; before prepare()
+    void setSilenceFloor(float db);
+
+    void setEnabled(size_t index, bool on);
+    void setParam(size_t index, int param, float value);
+    void apply(const EffectCommand& cmd);
+
+    bool threaded() const { return stages.size() > 1; }
+    size_t stageCount() const { return stages.size(); }
+    // the graph's own latency plus one period when threaded
+    float latencySamples() const;
+    // periods the pipeline hadn't finished when the next was due
+    uint64_t lateBlocks() const { return late.load(std::memory_order_relaxed); }
+
+    // mono in, planar stereo out, any n; in may alias outL
+    void processBlock(const float* in, float* outL, float* outR, size_t n);
+
+private:
+    static constexpr size_t MAX_SUBS = 64;
+
+    struct Stage {
+        EffectGraph graph;
+        SpscQueue<int, MAX_SUBS> todo;             // sub-block indices
+        SpscQueue<EffectCommand, 256> commands;
+        std::thread worker;
+    };
+
+    void work(size_t s);
+    void startBlock();
+    void finishBlock();
+    void stop();
+
+    std::vector<std::unique_ptr<Stage>> stages;
+    std::vector<int> nodeStage, nodeLocal;        // global node -> stage, index in it
+
+    size_t period = 0, subLen = 0, subs = 0;
+    std::vector<float> pendIn, jobIn;             // filling / in the pipeline
+    std::vector<float> bufL, bufR;                // worked on in place by the stages
+    std::vector<float> readyL, readyR;            // last finished period
+    size_t fill = 0;
+    bool inFlight = false;
+
+    std::atomic<bool> running{false};
+    std::atomic<size_t> done{0};                  // sub-blocks out of the last stage
+    std::atomic<uint64_t> late{0};
+};
@@ -1,52 +1,131 @@
 #include "reverb.h"
+#include <algorithm>
+#include "denormal.h"
+#include "tail.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+// Comb and allpass delays in seconds (prime-ish values for smoothness)
+static const float COMB_SEC[4] = { 0.0297f, 0.0371f, 0.0411f, 0.0437f };
+static const float COMB_FEEDBACK[4] = { 0.78f, 0.80f, 0.82f, 0.76f };
+static const float ALLPASS_SEC[2] = { 0.0050f, 0.0017f };
+
+// of the FDN's lines zeroed per block after a mode switch
+static const size_t CLEAR_BYTES = 256 * 1024;
+
+static size_t delaySamples(float sec, int sr) {
+    int samples = (int)std::lround(sec * sr);   // nearest, so the times hold at every rate
+    return samples > 0 ? (size_t)samples : 0;
+}
+
 // ---------------- Delay implementation ----------------
-void Reverb::Delay::init(int samples, float fb) {
-    buf.assign(samples, 0.0f);
-    idx = 0;
+void Reverb::Delay::init(int samples, float fb, MemoryArena* arena) {
+    length = samples;
+    line.prepare(samples > 0 ? samples : 0, 0, arena);
     feedback = fb;
 }
 
 float Reverb::Delay::process(float in) {
-    if (buf.empty()) return in;
-
-    float out = buf[idx];
-    buf[idx] = in + out * feedback;
+    if (length <= 0) return in;
 
-    idx++;
-    if (idx >= (int)buf.size()) idx = 0;
+    float out = line.at(length - 1);
+    line.push(flushDenormal(in + out * feedback));
 
     return out;
 }
 
+void Reverb::Delay::processBlock(const float* in, float* out, size_t n) {
+    if (length <= 0) {
+        if (out != in) std::copy(in, in + n, out);
+        return;
+    }
+
+    const size_t d = (size_t)length - 1;
+    const float fb = feedback;
+    for (size_t i = 0; i < n; ++i) {
+        float o = line.at(d);
+        line.push(flushDenormal(in[i] + o * fb));
+        out[i] = o;
+    }
+}
+
 void Reverb::Delay::clear() {
-    std::fill(buf.begin(), buf.end(), 0.0f);
-    idx = 0;
+    line.clear();
+}
+
+void Reverb::Delay::clearState() {
+    line.clearState();
 }
 
 // ---------------- Reverb implementation ----------------
 
-Reverb::Reverb() : sr(48000) {}
+Reverb::Reverb() : mode(MODE_SCHROEDER), sr(48000) {}
+
+size_t Reverb::memoryRequirement(int sampleRate) const {
+    sampleRate = DecimatedPath::rateFor(sampleRate, decimate);
+    size_t bytes = mode != MODE_SCHROEDER ? fdn.memoryRequirement(sampleRate) : 0;
+    for (float sec : COMB_SEC)
+        bytes += DelayLine<Interp::None>::memoryRequirement(delaySamples(sec, sampleRate));
+    for (float sec : ALLPASS_SEC)
+        bytes += DelayLine<Interp::None>::memoryRequirement(delaySamples(sec, sampleRate));
+    return bytes;
+}
 
-void Reverb::prepare(int sampleRate) {
-    sr = sampleRate;
+void Reverb::prepare(int sampleRate, MemoryArena* arena) {
+    sr = DecimatedPath::rateFor(sampleRate, decimate);
+    path.prepare(decimate, 1);
 
-    // Comb delays (prime-ish values for smoothness)
-    combs[0].init(int(0.0297f * sr), 0.78f);
-    combs[1].init(int(0.0371f * sr), 0.80f);
-    combs[2].init(int(0.0411f * sr), 0.82f);
-    combs[3].init(int(0.0437f * sr), 0.76f);
+    for (int k = 0; k < 4; ++k)
+        combs[k].init((int)delaySamples(COMB_SEC[k], sr), COMB_FEEDBACK[k], arena);
+    for (int k = 0; k < 2; ++k)
+        allpasses[k].init((int)delaySamples(ALLPASS_SEC[k], sr), 0.70f, arena);
 
-    // Allpass delays
-    allpasses[0].init(int(0.0050f * sr), 0.70f);
-    allpasses[1].init(int(0.0017f * sr), 0.70f);
+    // the FDN's lines are about 1 MB at 48 kHz, so only in an FDN mode
+    if (mode != MODE_SCHROEDER) fdn.prepare(sr, arena);
+    else fdn.release();
+}
+
+void Reverb::setMode(Mode m) {
+    if (m == mode) return;
+    mode = m;
+    if (mode != MODE_SCHROEDER) {
+        fdn.setLines(mode == MODE_FDN16 ? 16 : 8);
+        fdn.beginClear();
+    }
+}
+
+size_t Reverb::tailSamples() const {
+    size_t tail = 0;
+    if (fdnOn()) {
+        tail = fdn.tailSamples();
+    } else {
+        // the longest comb, then through both allpasses
+        for (const Delay& c : combs) tail = std::max(tail, feedbackTail((float)c.length, c.feedback));
+        for (const Delay& a : allpasses) tail += feedbackTail((float)a.length, a.feedback);
+    }
+    return tail * (size_t)decimate + (size_t)std::ceil(latencySamples());
+}
+
+void Reverb::setParam(int id, float value) {
+    switch (id) {
+        case PARAM_MODE:       setMode((Mode)std::min(2, std::max(0, (int)value))); break;
+        case PARAM_SIZE:       fdn.setSize(value); break;
+        case PARAM_DECAY:      fdn.setDecay(value); break;
+        case PARAM_DAMPING:    fdn.setDamping(value); break;
+        case PARAM_MODULATION: fdn.setModulation(value); break;
+        case PARAM_DECIMATE:   setDecimation((int)value); break;
+    }
 }
 
 float Reverb::process(float in) {
+    if (decimate > 1 || mode != MODE_SCHROEDER) {
+        float out;
+        processBlock(&in, &out, 1);
+        return out;
+    }
+
     // Parallel comb section
     float cSum = 0.0f;
     for (auto &c : combs)
@@ -64,7 +143,62 @@ float Reverb::process(float in) {
     return apOut;
 }
 
+void Reverb::processBlock(const float* in, float* out, size_t n) {
+    if (decimate > 1) {
+        path.process(in, out, nullptr, n, [this](const float* x, float* y, float*, size_t m) {
+            wetBlock(x, y, m);
+        });
+        return;
+    }
+    wetBlock(in, out, n);
+}
+
+void Reverb::wetBlock(const float* in, float* out, size_t n) {
+    // Schroeder until the FDN's lines are clear after a switch
+    if (fdnOn() && fdn.clearSlice(CLEAR_BYTES)) {
+        fdn.processBlock(in, out, n);
+        return;
+    }
+
+    // Work in chunks so the planar scratch buffers stay on the stack
+    constexpr size_t CHUNK = 256;
+    float comb[CHUNK];
+    float sum[CHUNK];
+    float delayed[CHUNK];
+
+    while (n > 0) {
+        size_t m = n < CHUNK ? n : CHUNK;
+
+        // Parallel comb section
+        combs[0].processBlock(in, sum, m);
+        for (int c = 1; c < 4; ++c) {
+            combs[c].processBlock(in, comb, m);
+            for (size_t i = 0; i < m; ++i) sum[i] += comb[i];
+        }
+        for (size_t i = 0; i < m; ++i) sum[i] *= 0.25f;
+
+        // Serial allpass section
+        for (auto &ap : allpasses) {
+            ap.processBlock(sum, delayed, m);
+            for (size_t i = 0; i < m; ++i) sum[i] = delayed[i] * -0.5f + sum[i];
+        }
+
+        std::copy(sum, sum + m, out);
+        in += m; out += m; n -= m;
+    }
+}
+
 void Reverb::reset() {
     for (auto &c : combs) c.clear();
     for (auto &a : allpasses) a.clear();
+    // idle in Schroeder mode; setMode() clears it on the way in
+    if (fdnOn()) fdn.reset();
+    path.reset();
+}
+
+void Reverb::resetState() {
+    for (auto &c : combs) c.clearState();
+    for (auto &a : allpasses) a.clearState();
+    fdn.resetState();
+    path.reset();
 }
@@ -1,23 +1,61 @@
 #pragma once
 #include <vector>
 #include <cmath>
+#include <cstddef>
+#include "delay_line.h"
+#include "fdn_reverb.h"
+#include "decimated_path.h"
 
 class Reverb {
 public:
     Reverb();
-    void prepare(int sampleRate);
+    // arena bytes prepare(sampleRate, arena) takes
+    size_t memoryRequirement(int sampleRate) const;
+    // delay lines from the arena if one is given, else allocated
+    void prepare(int sampleRate, MemoryArena* arena = nullptr);
     float process(float in);
+    // process n samples; in and out may alias
+    void processBlock(const float* in, float* out, size_t n);
     void reset();
+    // reset() without clearing the delay lines, for an owner that has
+    // zeroed the arena they are in (EffectGraph, a slice per block)
+    void resetState();
+
+    // Schroeder is the original 4-comb/2-allpass design. The FDN's lines
+    // are only taken by a reverb prepared in an FDN mode, so one prepared
+    // in Schroeder mode switches to FDN at the next prepare(). Between
+    // FDN modes the switch clears the lines a slice per block, running
+    // Schroeder until they are clear.
+    enum Mode { MODE_SCHROEDER, MODE_FDN8, MODE_FDN16 };
+    void setMode(Mode m);
+    Mode getMode() const { return mode; }
+
+    // runs the whole reverb at 1/2 or 1/4 of the rate, for half or a
+    // quarter of its memory and work; the tail loses what's above the
+    // divided rate's band and starts latencySamples() later. Takes effect
+    // at the next prepare().
+    void setDecimation(int factor) { decimate = DecimatedPath::roundFactor(factor); }
+    int getDecimation() const { return decimate; }
+    float latencySamples() const { return decimate > 1 ? path.latencySamples() : 0.0f; }
+    // host samples it rings for once the input stops (tail.h)
+    size_t tailSamples() const;
+
+    // SIZE, DECAY, DAMPING and MODULATION are for the FDN modes only
+    enum Param { PARAM_MODE, PARAM_SIZE, PARAM_DECAY, PARAM_DAMPING, PARAM_MODULATION,
+                 PARAM_DECIMATE = 96 };
+    void setParam(int id, float value);
 
 private:
     struct Delay {
-        std::vector<float> buf;
-        int idx = 0;
+        DelayLine<Interp::None> line;
+        int length = 0;
         float feedback = 0.7f;
 
-        void init(int samples, float fb);
+        void init(int samples, float fb, MemoryArena* arena);
         float process(float in);
+        void processBlock(const float* in, float* out, size_t n);
         void clear();
+        void clearState();
     };
 
     // Comb filters
@@ -26,5 +64,14 @@ private:
     // Allpass filters
     Delay allpasses[2];
 
+    FdnReverb fdn;
+    Mode mode;
+    bool fdnOn() const { return mode != MODE_SCHROEDER && fdn.hasLines(); }
+
+    // at the divided rate when decimated
+    void wetBlock(const float* in, float* out, size_t n);
+    int decimate = 1;
+    DecimatedPath path;
+
     int sr;
 };
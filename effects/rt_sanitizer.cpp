@@ -0,0 +1,192 @@
+#include "rt_sanitizer.h"
+
+#ifdef RT_SANITIZE
+#include <atomic>
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// glibc's own allocator, under the names it exports for malloc hooks
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* p);
+}
+
+static thread_local int realtimeDepth = 0;
+static thread_local bool reporting = false;    // the report's own calls pass
+static std::atomic<size_t> violationCount{0};
+static std::atomic<bool> abortOnViolation{true};
+
+ScopedRealtime::ScopedRealtime() { ++realtimeDepth; }
+ScopedRealtime::~ScopedRealtime() { --realtimeDepth; }
+
+void rtSanitizerAbort(bool abortOn) { abortOnViolation.store(abortOn); }
+size_t rtViolations() { return violationCount.load(); }
+
+// straight to the kernel, past the write() below
+static void report(const char* s) {
+    syscall(SYS_write, 2, s, strlen(s));
+}
+
+static void check(const char* call) {
+    if (realtimeDepth == 0 || reporting) return;
+    reporting = true;
+    violationCount.fetch_add(1);
+    report("rt_sanitizer: ");
+    report(call);
+    report(" on a realtime thread\n");
+    void* frames[48];
+    int n = backtrace(frames, 48);
+    backtrace_symbols_fd(frames + 1, n - 1, 2);    // from the caller of the call
+    if (abortOnViolation.load()) abort();
+    reporting = false;
+}
+
+// the next definition of a symbol (libc's), looked up on first use
+template <typename F>
+static F next(F& cached, const char* name) {
+    if (!cached) cached = (F)dlsym(RTLD_NEXT, name);
+    return cached;
+}
+
+// ------------------ Allocation ------------------------
+extern "C" void* malloc(size_t size) {
+    check("malloc");
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    check("calloc");
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* p, size_t size) {
+    check("realloc");
+    return __libc_realloc(p, size);
+}
+
+extern "C" void free(void* p) {
+    if (p) check("free");
+    __libc_free(p);
+}
+
+extern "C" void* memalign(size_t alignment, size_t size) {
+    check("memalign");
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size) {
+    check("aligned_alloc");
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void** p, size_t alignment, size_t size) {
+    check("posix_memalign");
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1))) return 22;   // EINVAL
+    *p = __libc_memalign(alignment, size);
+    return *p ? 0 : 12;                                                        // ENOMEM
+}
+
+// the array, nothrow and aligned forms all come here or to the C calls
+void* operator new(size_t size) {
+    check("operator new");
+    void* p = __libc_malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    if (p) check("operator delete");
+    __libc_free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    if (p) check("operator delete");
+    __libc_free(p);
+}
+
+// ------------------ Locks -----------------------------
+extern "C" int pthread_mutex_lock(pthread_mutex_t* m) {
+    static int (*real)(pthread_mutex_t*) = nullptr;
+    check("pthread_mutex_lock");
+    return next(real, "pthread_mutex_lock")(m);
+}
+
+extern "C" int pthread_mutex_unlock(pthread_mutex_t* m) {
+    static int (*real)(pthread_mutex_t*) = nullptr;
+    check("pthread_mutex_unlock");
+    return next(real, "pthread_mutex_unlock")(m);
+}
+
+extern "C" int pthread_cond_wait(pthread_cond_t* c, pthread_mutex_t* m) {
+    static int (*real)(pthread_cond_t*, pthread_mutex_t*) = nullptr;
+    check("pthread_cond_wait");
+    return next(real, "pthread_cond_wait")(c, m);
+}
+
+// ------------------ Blocking syscalls -----------------
+extern "C" ssize_t read(int fd, void* buf, size_t n) {
+    static ssize_t (*real)(int, void*, size_t) = nullptr;
+    check("read");
+    return next(real, "read")(fd, buf, n);
+}
+
+extern "C" ssize_t write(int fd, const void* buf, size_t n) {
+    static ssize_t (*real)(int, const void*, size_t) = nullptr;
+    check("write");
+    return next(real, "write")(fd, buf, n);
+}
+
+extern "C" int open(const char* path, int flags, ...) {
+    static int (*real)(const char*, int, ...) = nullptr;
+    check("open");
+    va_list args;
+    va_start(args, flags);
+    int mode = va_arg(args, int);    // only read by open() when O_CREAT is set
+    va_end(args);
+    return next(real, "open")(path, flags, mode);
+}
+
+extern "C" int close(int fd) {
+    static int (*real)(int) = nullptr;
+    check("close");
+    return next(real, "close")(fd);
+}
+
+extern "C" int nanosleep(const struct timespec* t, struct timespec* left) {
+    static int (*real)(const struct timespec*, struct timespec*) = nullptr;
+    check("nanosleep");
+    return next(real, "nanosleep")(t, left);
+}
+
+extern "C" int clock_nanosleep(clockid_t clock, int flags, const struct timespec* t,
+                               struct timespec* left) {
+    static int (*real)(clockid_t, int, const struct timespec*, struct timespec*) = nullptr;
+    check("clock_nanosleep");
+    return next(real, "clock_nanosleep")(clock, flags, t, left);
+}
+
+extern "C" int usleep(useconds_t us) {
+    static int (*real)(useconds_t) = nullptr;
+    check("usleep");
+    return next(real, "usleep")(us);
+}
+
+extern "C" unsigned sleep(unsigned s) {
+    static unsigned (*real)(unsigned) = nullptr;
+    check("sleep");
+    return next(real, "sleep")(s);
+}
+
+#endif
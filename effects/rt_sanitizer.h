@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+
+// Realtime-safety checks for the audio path. Built with -DRT_SANITIZE
+// (Linux/glibc; link with -rdynamic for function names and -ldl on older
+// glibc), rt_sanitizer.cpp interposes malloc/free and friends, operator
+// new/delete, pthread mutex and condition variable calls and the blocking
+// syscalls (read, write, open, close, sleeps). Called from a thread inside
+// a ScopedRealtime, each reports the call with a backtrace on stderr and
+// aborts, or only counts it after rtSanitizerAbort(false).
+//
+// Without RT_SANITIZE everything here is an empty inline and costs nothing.
+//
+// Mark the audio callback and the parts of helper threads that run on its
+// deadline; scopes nest. Spinning and yielding aren't checked: the
+// callback's waits on its own workers do that by design.
+
+#ifdef RT_SANITIZE
+
+class ScopedRealtime {
+public:
+    ScopedRealtime();
+    ~ScopedRealtime();
+    ScopedRealtime(const ScopedRealtime&) = delete;
+    ScopedRealtime& operator=(const ScopedRealtime&) = delete;
+};
+
+const bool RT_SANITIZER_ENABLED = true;
+// abort on the first violation (the default) or report and carry on
+void rtSanitizerAbort(bool abortOnViolation);
+// violations reported so far, all threads
+size_t rtViolations();
+
+#else
+
+class ScopedRealtime {
+public:
+    ScopedRealtime() {}
+};
+
+const bool RT_SANITIZER_ENABLED = false;
+inline void rtSanitizerAbort(bool) {}
+inline size_t rtViolations() { return 0; }
+
+#endif
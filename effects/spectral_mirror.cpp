@@ -3,31 +3,46 @@
 
 
 SpectralMirror::SpectralMirror()
-: writeIndex(0), delaySamples(0), delayMs(2.0f), sampleRate(48000)
+: delaySamples(0), delayMs(2.0f), sampleRate(48000)
 { }
 
 
-void SpectralMirror::prepare(int sr) {
+size_t SpectralMirror::memoryRequirement(int sr) const {
+    return DelayLine<Interp::None>::memoryRequirement(sr / 100, CHUNK);
+}
+
+void SpectralMirror::prepare(int sr, MemoryArena* arena) {
     sampleRate = sr;
     delaySamples = int((delayMs / 1000.0f) * sampleRate);
     if (delaySamples < 1) delaySamples = 1;
-    delayBuffer.assign(sampleRate / 100, 0.0f); // 10ms buffer
-    writeIndex = 0;
+    line.prepare(sampleRate / 100, CHUNK, arena); // 10ms buffer
 }
 
 
 float SpectralMirror::process(float in) {
-    if (delayBuffer.empty()) return in;
-    int readIndex = writeIndex - delaySamples;
-    if (readIndex < 0) readIndex += (int)delayBuffer.size();
-    float d = delayBuffer[readIndex];
-    delayBuffer[writeIndex] = in;
-    writeIndex = (writeIndex + 1) % (int)delayBuffer.size();
+    if (line.capacity() == 0) return in;
+    line.push(in);
+    float d = line.at(delaySamples);
     return d - in;
 }
 
 
+void SpectralMirror::processBlock(const float* in, float* out, size_t n) {
+    if (line.capacity() == 0) {
+        if (out != in) std::copy(in, in + n, out);
+        return;
+    }
+    float d[CHUNK];
+    while (n > 0) {
+        size_t m = std::min(n, CHUNK);
+        line.writeBlock(in, m);
+        line.readBlock((float)delaySamples, d, m);
+        for (size_t i = 0; i < m; ++i) out[i] = d[i] - in[i];
+        in += m; out += m; n -= m;
+    }
+}
+
+
 void SpectralMirror::reset() {
-    std::fill(delayBuffer.begin(), delayBuffer.end(), 0.0f);
-    writeIndex = 0;
-}
\ No newline at end of file
+    line.clear();
+}
@@ -1,17 +1,26 @@
 #pragma once
 #include <vector>
+#include <cstddef>
+#include "delay_line.h"
 
 
 class SpectralMirror {
 public:
     SpectralMirror();
-    void prepare(int sampleRate);
+    // arena bytes prepare(sampleRate, arena) takes
+    size_t memoryRequirement(int sampleRate) const;
+    // delay line from the arena if one is given, else allocated
+    void prepare(int sampleRate, MemoryArena* arena = nullptr);
     float process(float in);
+    // process n samples; in and out may alias
+    void processBlock(const float* in, float* out, size_t n);
     void reset();
+    // samples it rings for once the input stops: the delayed copy
+    size_t tailSamples() const { return (size_t)delaySamples; }
 private:
-    std::vector<float> delayBuffer;
-    int writeIndex;
+    static constexpr size_t CHUNK = 256;
+    DelayLine<Interp::None> line;
     int delaySamples;
     float delayMs;
     int sampleRate;
-};
\ No newline at end of file
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+// Wait-free single-producer / single-consumer ring buffer.
+//
+// One thread may push() and one other thread may pop(); neither call locks,
+// allocates or spins. CAPACITY must be a power of two. The read and write
+// indices sit on separate cache lines so the two threads don't false-share.
+template <typename T, size_t CAPACITY>
+class SpscQueue {
+public:
+    static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0,
+                  "SpscQueue capacity must be a power of two");
+
+    // producer side; returns false (and drops nothing) when full
+    bool push(const T& item) {
+        size_t w = writePos.load(std::memory_order_relaxed);
+        size_t r = readPos.load(std::memory_order_acquire);
+        if (w - r == CAPACITY) return false;
+        items[w & MASK] = item;
+        writePos.store(w + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side; returns false when empty
+    bool pop(T& item) {
+        size_t r = readPos.load(std::memory_order_relaxed);
+        size_t w = writePos.load(std::memory_order_acquire);
+        if (r == w) return false;
+        item = items[r & MASK];
+        readPos.store(r + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side; look at the next item without removing it
+    const T* peek() const {
+        size_t r = readPos.load(std::memory_order_relaxed);
+        size_t w = writePos.load(std::memory_order_acquire);
+        return r == w ? nullptr : &items[r & MASK];
+    }
+
+    bool empty() const {
+        return readPos.load(std::memory_order_acquire) ==
+               writePos.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr size_t MASK = CAPACITY - 1;
+
+    alignas(64) std::atomic<size_t> writePos{0};
+    alignas(64) std::atomic<size_t> readPos{0};
+    alignas(64) T items[CAPACITY];
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Tail lengths, for effects that report how long they keep ringing once
+// their input has gone quiet (tailSamples()): the samples until what is
+// left is TAIL_DB under what went in, i.e. below a 16-bit floor after a
+// full-scale note.
+const float TAIL_DB = 96.0f;
+// output that never settles to silence, e.g. a DC offset
+const size_t ENDLESS_TAIL = SIZE_MAX;
+
+// samples for a feedback loop `loop` samples long with `gain` per trip
+// to die away by TAIL_DB
+inline size_t feedbackTail(float loop, float gain) {
+    gain = std::fabs(gain);
+    if (gain <= 0.0f) return (size_t)std::ceil(loop);
+    if (gain >= 1.0f) return ENDLESS_TAIL;
+    const float trips = TAIL_DB / (-20.0f * std::log10(gain));
+    return (size_t)std::ceil(loop * (trips + 1.0f));
+}
+
+// a + b, staying at ENDLESS_TAIL once either is
+inline size_t addTails(size_t a, size_t b) {
+    return a > ENDLESS_TAIL - b ? ENDLESS_TAIL : a + b;
+}
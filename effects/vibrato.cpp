@@ -1,45 +1,73 @@
 #include "vibrato.h"
 #include <cmath>
-#include <cstring>
+#include <algorithm>
 
 
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
+// the read sweeps 0..2*depth behind the write
+static size_t maxDelay(int sampleRate) {
+    return (size_t)std::ceil(2.0f * Vibrato::MAX_DEPTH_MS * 0.001f * (float)sampleRate) + 2;
+}
 
 
 Vibrato::Vibrato()
-: writeIdx(0), depth(18.0f), rate(2.0f), sampleRate(48000), sampleCounter(0)
+: depthMs(0.375f), depth(18.0f), sampleRate(48000)     // 18 samples at 48 kHz
 {
-    std::memset(delayBuf, 0, sizeof(delayBuf));
+    line.prepare(maxDelay(sampleRate), CHUNK);
+    lfo.setRate(2.0f);
 }
 
 
-void Vibrato::prepare(int sr) {
+size_t Vibrato::memoryRequirement(int sr) const {
+    return DelayLine<Interp::Linear>::memoryRequirement(maxDelay(sr), CHUNK);
+}
+
+void Vibrato::prepare(int sr, MemoryArena* arena) {
     sampleRate = sr;
-    writeIdx = 0;
-    sampleCounter = 0;
+    line.prepare(maxDelay(sr), CHUNK, arena);
+    lfo.prepare(sr);
+    depth = depthMs * 0.001f * (float)sr;
 }
 
 
 float Vibrato::process(float input) {
-    delayBuf[writeIdx] = input;
-    float lfo = sinf(2.0f * M_PI * rate * (float)sampleCounter / (float)sampleRate);
-    float readDelay = depth * lfo + depth; // positive offset
-    float readIdx = (float)writeIdx - readDelay;
-    while (readIdx < 0) readIdx += MAX_DELAY;
-    int i1 = (int)readIdx;
-    int i2 = (i1 + 1) % MAX_DELAY;
-    float frac = readIdx - (float)i1;
-    float out = delayBuf[i1] * (1.0f - frac) + delayBuf[i2] * frac;
-    writeIdx = (writeIdx + 1) % MAX_DELAY;
-    sampleCounter++;
-    return out;
+    line.push(input);
+    float readDelay = depth * lfo.next() + depth; // positive offset
+    return line.read(readDelay);
+}
+
+
+void Vibrato::processBlock(const float* in, float* out, size_t n) {
+    float delays[CHUNK];
+    while (n > 0) {
+        size_t m = std::min(n, CHUNK);
+        lfo.render(delays, m);
+        for (size_t i = 0; i < m; ++i) delays[i] = depth * delays[i] + depth;
+
+        line.writeBlock(in, m);
+        line.readBlock(delays, out, m);
+
+        in += m; out += m; n -= m;
+    }
 }
 
 
 void Vibrato::reset() {
-    std::memset(delayBuf, 0, sizeof(delayBuf));
-    writeIdx = 0;
-    sampleCounter = 0;
-}
\ No newline at end of file
+    line.clear();
+    lfo.reset();
+}
+
+
+void Vibrato::setParam(int id, float value) {
+    switch (id) {
+        case PARAM_RATE:
+            lfo.setRate(std::min(20.0f, std::max(0.01f, value)));
+            break;
+        case PARAM_DEPTH:
+            depthMs = std::min(MAX_DEPTH_MS, std::max(0.0f, value));
+            depth = depthMs * 0.001f * (float)sampleRate;
+            break;
+        case PARAM_SHAPE:
+            lfo.setShape((Lfo::Shape)std::min(3, std::max(0, (int)std::lround(value))));
+            break;
+    }
+}
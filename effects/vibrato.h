@@ -1,18 +1,32 @@
 #pragma once
+#include <cstddef>
+#include "delay_line.h"
+#include "lfo.h"
 
 
 class Vibrato {
 public:
     Vibrato();
-    void prepare(int sampleRate);
+    // arena bytes prepare(sampleRate, arena) takes
+    size_t memoryRequirement(int sampleRate) const;
+    // delay line from the arena if one is given, else allocated
+    void prepare(int sampleRate, MemoryArena* arena = nullptr);
     float process(float in);
+    // process n samples; in and out may alias
+    void processBlock(const float* in, float* out, size_t n);
     void reset();
+
+    // PARAM_DEPTH in ms (0 to MAX_DEPTH_MS), PARAM_SHAPE an Lfo::Shape
+    enum Param { PARAM_RATE, PARAM_DEPTH, PARAM_SHAPE };
+    static constexpr float MAX_DEPTH_MS = 10.0f;
+    void setParam(int id, float value);
+    // samples it rings for once the input stops: the longest read delay
+    size_t tailSamples() const { return (size_t)(2.0f * depth) + 2; }
 private:
-    static const int MAX_DELAY = 1024;
-    float delayBuf[MAX_DELAY];
-    int writeIdx;
-    float depth; // in samples
-    float rate; // hz
+    static constexpr size_t CHUNK = 256;
+    DelayLine<Interp::Linear> line;
+    Lfo lfo;
+    float depthMs;
+    float depth; // in samples, from depthMs
     int sampleRate;
-    unsigned long sampleCounter;
-};
\ No newline at end of file
+};
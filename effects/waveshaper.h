@@ -0,0 +1,207 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "fast_math.h"
+
+// Static waveshaping curves, each with the antiderivatives used for
+// antiderivative anti-aliasing (ADAA). F1 is the first antiderivative of f,
+// F2 the second, both zero at x = 0. They are evaluated in double: the ADAA
+// difference quotients cancel most of their digits.
+
+// f(x) = clamp(x, -1, 1). Every piece is written with the clamped value so
+// none of them branch.
+struct HardClip {
+    float f(float x) const { return std::min(std::max(x, -1.0f), 1.0f); }
+    double F1(double x) const {
+        double c = std::min(std::max(x, -1.0), 1.0);
+        return x * c - 0.5 * c * c;
+    }
+    double F2(double x) const {
+        double c = std::min(std::max(x, -1.0), 1.0);
+        return 0.5 * c * x * x - 0.5 * c * c * x + c * c * c / 6.0;
+    }
+};
+
+// f(x) = tanh(x)
+struct TanhClip {
+    float f(float x) const { return fastTanh(x); }
+    // log(cosh(x)), without overflowing for large |x|
+    double F1(double x) const {
+        double a = std::fabs(x);
+        return a + std::log1p(std::exp(-2.0 * a)) - LN2;
+    }
+    // x^2/2 - x ln2 + Li2(-e^-2x)/2 + pi^2/24 for x >= 0, odd. The last two
+    // terms are a polynomial in e^-2x, within 1.2e-11 and smooth (exact to
+    // second order at 0), so the ADAA differences are within 3e-8 of f's.
+    // No libm call or loop: the block kernel's F2 pass vectorizes.
+    double F2(double x) const {
+        double a = std::fabs(x);
+        double s = 2.0 * expMinus2(a) - 1.0;        // [-1, 1]
+        double p = -3.7361380840001359e-8;
+        p = p * s + 1.5635129202817354e-7;
+        p = p * s + -4.5349070981274434e-7;
+        p = p * s + 1.6526793090692941e-6;
+        p = p * s + -6.593793797732541e-6;
+        p = p * s + 2.6780442009761135e-5;
+        p = p * s + -1.1441744667740146e-4;
+        p = p * s + 5.2881136346591565e-4;
+        p = p * s + -2.7627021498074554e-3;
+        p = p * s + 1.8032944272707686e-2;
+        p = p * s + -0.20273255410774571;
+        p = p * s + 0.18702641324133449;            // so F2(0) = 0
+        return std::copysign(0.5 * a * a - a * LN2 + p, x);
+    }
+
+private:
+    static constexpr double LN2 = 0.69314718055994530942;
+
+    // e^-2a for a >= 0, as fast_math.h does it in float; a is capped at 40
+    // (the min written with fabs, so it vectorizes), far past where F2 can
+    // tell e^-2a from 0
+    static double expMinus2(double a) {
+        const double LOG2E = 1.4426950408889634, MAGIC = 6755399441055744.0;   // 1.5 * 2^52
+        const double LN2_HI = 6.93147180369123816490e-01, LN2_LO = 1.90821492927058770002e-10;
+        const double over = a - 40.0;
+        const double y = -2.0 * (a - 0.5 * (over + std::fabs(over)));
+        const double km = y * LOG2E + MAGIC;        // round(y / ln2) in the low bits
+        const double k = km - MAGIC;
+        const double r = (y - k * LN2_HI) - k * LN2_LO;    // [-ln2/2, ln2/2]
+        double e = 2.7626358277706801e-7;
+        e = e * r + 2.7632642126375147e-6;
+        e = e * r + 2.4801504344197185e-5;
+        e = e * r + 1.9841190644058748e-4;
+        e = e * r + 1.3888888932491121e-3;
+        e = e * r + 8.3333333673142202e-3;
+        e = e * r + 4.1666666666573134e-2;
+        e = e * r + 0.16666666666615641;
+        e = e * r + 0.50000000000000056;
+        e = e * r + 1.0000000000000012;
+        e = e * r + 1.0;
+        uint64_t bits;
+        std::memcpy(&bits, &km, sizeof bits);
+        bits = (bits + 1023) << 52;                 // 2^k
+        double scale;
+        std::memcpy(&scale, &bits, sizeof scale);
+        return e * scale;
+    }
+};
+
+// f(x) = x / (1 + k|x|), the soft limiter used across the effects
+struct SoftClip {
+    float k = 1.0f;
+
+    float f(float x) const { return x / (1.0f + std::fabs(x) * k); }
+    double F1(double x) const {
+        double a = std::fabs(x);
+        return a / k - std::log1p(k * a) / ((double)k * k);
+    }
+    double F2(double x) const {
+        double a = std::fabs(x), ka = k * a;
+        double v = 0.5 * a * a / k - ((1.0 + ka) * std::log1p(ka) - ka) / ((double)k * k * k);
+        return x < 0.0 ? -v : v;
+    }
+};
+
+// Applies a curve with no anti-aliasing (order 0) or first/second-order
+// ADAA. Order 1 delays the signal by half a sample, order 2 by one. Block
+// kernels work a chunk at a time: all antiderivatives first, then the
+// differences, so the curve evaluations stay out of the serial part.
+template <typename Curve>
+class Waveshaper {
+public:
+    Curve curve;
+
+    void setOrder(int o) {
+        int n = std::min(2, std::max(0, o));
+        if (n != ord) { ord = n; reset(); }
+    }
+    int order() const { return ord; }
+    float latencySamples() const { return 0.5f * (float)ord; }
+
+    void reset() { x1 = x2 = 0.0; }
+
+    float process(float x) {
+        float y;
+        processBlock(&x, &y, 1);
+        return y;
+    }
+
+    // process n samples; in and out may alias
+    void processBlock(const float* in, float* out, size_t n) {
+        if (ord == 0) {
+            for (size_t i = 0; i < n; ++i) out[i] = curve.f(in[i]);
+            return;
+        }
+        while (n > 0) {
+            size_t m = std::min(n, CHUNK);
+            if (ord == 1) first(in, out, m);
+            else second(in, out, m);
+            in += m; out += m; n -= m;
+        }
+    }
+
+private:
+    static constexpr size_t CHUNK = 64;
+    static constexpr size_t LANES = 4;
+    static constexpr double EPS1 = 1e-5;   // below this step, fall back to f at the midpoint
+    static constexpr double EPS2 = 1e-3;   // second order divides twice, so needs more room
+
+    // y[n] = (F1(x[n]) - F1(x[n-1])) / (x[n] - x[n-1])
+    void first(const float* in, float* out, size_t m) {
+        double X[CHUNK + 1], F[CHUNK + 1];
+        X[0] = x1;
+        for (size_t i = 0; i < m; ++i) X[i + 1] = in[i];
+        for (size_t i = 0; i <= m; ++i) F[i] = curve.F1(X[i]);
+
+        for (size_t i = 0; i < m; ++i) {
+            double d = X[i + 1] - X[i];
+            out[i] = std::fabs(d) > EPS1 ? (float)((F[i + 1] - F[i]) / d)
+                                         : curve.f((float)(0.5 * (X[i + 1] + X[i])));
+        }
+        x1 = X[m];
+    }
+
+    // y[n] = 2 / (x[n] - x[n-2]) * (D(x[n], x[n-1]) - D(x[n-1], x[n-2])),
+    // D(a, b) = (F2(a) - F2(b)) / (a - b)
+    void second(const float* in, float* out, size_t m) {
+        double X[CHUNK + 2 + LANES], F[CHUNK + 2 + LANES], D[CHUNK + 1];
+        X[0] = x2;
+        X[1] = x1;
+        for (size_t i = 0; i < m; ++i) X[i + 2] = in[i];
+        // F2 in whole groups of LANES, which vectorizes at -O2 where the
+        // curve's F2 is straight-line; the padding repeats the last input
+        const size_t mv = (m + 2 + LANES - 1) & ~(LANES - 1);
+        for (size_t i = m + 2; i < mv; ++i) X[i] = X[m + 1];
+        for (size_t i = 0; i < mv; i += LANES)
+            for (size_t v = 0; v < LANES; ++v) F[i + v] = curve.F2(X[i + v]);
+        for (size_t i = 0; i <= m; ++i) {
+            double d = X[i + 1] - X[i];
+            D[i] = std::fabs(d) > EPS2 ? (F[i + 1] - F[i]) / d
+                                       : curve.F1(0.5 * (X[i + 1] + X[i]));
+        }
+
+        for (size_t i = 0; i < m; ++i) {
+            double d = X[i + 2] - X[i];
+            if (std::fabs(d) > EPS2) {
+                out[i] = (float)(2.0 * (D[i + 1] - D[i]) / d);
+            } else {
+                // x[n] ~ x[n-2]: expand around their midpoint
+                double mid = 0.5 * (X[i + 2] + X[i]);
+                double delta = mid - X[i + 1];
+                if (std::fabs(delta) > EPS2)
+                    out[i] = (float)(2.0 / delta *
+                                     (curve.F1(mid) + (F[i + 1] - curve.F2(mid)) / delta));
+                else
+                    out[i] = curve.f((float)(0.5 * (mid + X[i + 1])));
+            }
+        }
+        x2 = X[m];
+        x1 = X[m + 1];
+    }
+
+    int ord = 0;
+    double x1 = 0.0, x2 = 0.0;     // previous two inputs
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Waiting and placement helpers for the worker threads that help the
+// audio callback (PipelinedGraph, ChannelRack). Nothing here locks.
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// a worker with nothing to do: spin for a while after the last piece of
+// work, then back off so idle workers don't hold a core for the whole period
+inline void idleWait(int& spins) {
+    const int SPIN_LIMIT = 4000;
+    if (++spins < SPIN_LIMIT) cpuRelax();
+    else std::this_thread::sleep_for(std::chrono::microseconds(50));
+}
+
+// the audio thread waiting on workers: yield rather than spin once it's
+// clear they need the core (more workers than free cores)
+inline void busyWait(int& spins) {
+    const int SPIN_LIMIT = 4000;
+    if (++spins < SPIN_LIMIT) cpuRelax();
+    else std::this_thread::yield();
+}
+
+// SCHED_FIFO priority for workers started from now on; 0, the default,
+// leaves them on the normal scheduler. Set to the audio thread's own when
+// that runs realtime, so the callback yielding in busyWait() lets a worker
+// sharing its core run.
+inline int& workerPriority() {
+    static int priority = 0;
+    return priority;
+}
+
+// best effort, like pinToCore()
+inline void raisePriority(std::thread& t) {
+#ifdef __linux__
+    if (workerPriority() <= 0) return;
+    sched_param param{};
+    param.sched_priority = workerPriority();
+    pthread_setschedparam(t.native_handle(), SCHED_FIFO, &param);
+#else
+    (void)t;
+#endif
+}
+
+// core for the k-th worker thread (cores > 1): the others in turn from the
+// one after the audio callback's, never that one, as a worker at its
+// priority would take turns with it. audioCore -1 (unpinned) leaves core 0.
+inline unsigned workerCore(size_t k, int audioCore, unsigned cores) {
+    const unsigned audio = audioCore > 0 ? (unsigned)audioCore % cores : 0;
+    return (audio + 1 + (unsigned)(k % (cores - 1))) % cores;
+}
+
+// best effort; the thread runs unpinned where it fails or isn't supported
+inline void pinToCore(std::thread& t, unsigned core) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    pthread_setaffinity_np(t.native_handle(), sizeof set, &set);
+#else
+    (void)t; (void)core;
+#endif
+}
@@ -3,7 +3,7 @@
 #include <cstring>
 #include <portaudio.h>
 
-#define SAMPLE_RATE 48000
+static double sampleRate = 48000.0;   // the input device's, set in main()
 #define FRAMES_PER_BUFFER 256
 
 // === Auto-Swell Parameters ===
@@ -69,10 +69,6 @@ static int audioCallback(const void *inputBuffer, void *outputBuffer,
 
 int main() {
 
-    // Precompute envelope speeds
-    attackCoeff  = 1.0f / (attackTimeSec * SAMPLE_RATE);
-    releaseCoeff = 1.0f / (releaseTimeSec * SAMPLE_RATE);
-
     Pa_Initialize();
 
     // List devices
@@ -89,6 +85,11 @@ int main() {
     std::cout << "\nSelect INPUT device: ";
     std::cin >> inputIndex;
 
+    // Run at the device's rate, envelope speeds to match
+    sampleRate = Pa_GetDeviceInfo(inputIndex)->defaultSampleRate;
+    attackCoeff  = (float)(1.0 / (attackTimeSec * sampleRate));
+    releaseCoeff = (float)(1.0 / (releaseTimeSec * sampleRate));
+
     PaStreamParameters inP{}, outP{};
     inP.device = inputIndex;
     inP.channelCount = 1;
@@ -104,7 +105,7 @@ int main() {
 
     PaStream* stream;
     Pa_OpenStream(&stream, &inP, &outP,
-                  SAMPLE_RATE, FRAMES_PER_BUFFER,
+                  sampleRate, FRAMES_PER_BUFFER,
                   paNoFlag, audioCallback, nullptr);
 
     Pa_StartStream(stream);
@@ -3,6 +3,7 @@
 #include <vector>
 #include <cmath>
 #include <cstring>
+#include <algorithm>
 #include <portaudio.h>
 
 #ifndef M_PI
@@ -10,7 +11,6 @@
 #endif
 
 // ---------- CONFIG (tweak these) ----------
-constexpr int SAMPLE_RATE       = 48000;
 constexpr unsigned FRAMES_PER_BUFFER = 256;
 
 // Bitcrusher parameters (tweak to taste)
@@ -25,6 +25,8 @@ static int downsampleFactor = DOWNSAMPLE_FACTOR_DEFAULT;
 static int bitDepth = BIT_DEPTH_DEFAULT;
 static float dryLevel = DRY_LEVEL_DEFAULT;
 static float wetLevel = WET_LEVEL_DEFAULT;
+static double sampleRate = 48000.0;   // the input device's, set in main()
+static int rateMultiple = 1;          // hold times are set for 48 kHz
 
 // runtime state used in callback
 struct CrusherState {
@@ -85,7 +87,7 @@ static int audioCallback(const void* inputBuffer, void* outputBuffer,
             // compute new held sample: first quantize amplitude to bitDepth
             float q = quantizeSample(x, bitDepth);
             gState.heldSample = q;
-            gState.holdCounter = downsampleFactor;
+            gState.holdCounter = downsampleFactor * rateMultiple;
         }
         gState.holdCounter--;
 
@@ -155,6 +157,10 @@ int main() {
         return 1;
     }
 
+    // run at the device's rate
+    sampleRate = Pa_GetDeviceInfo(inputIndex)->defaultSampleRate;
+    rateMultiple = std::max(1, (int)std::lround(sampleRate / 48000.0));
+
     // prepare stream parameters
     PaStreamParameters inParams{};
     inParams.device = inputIndex;
@@ -178,7 +184,7 @@ int main() {
 
     PaStream* stream = nullptr;
     err = Pa_OpenStream(&stream, &inParams, &outParams,
-                        SAMPLE_RATE, FRAMES_PER_BUFFER, paClipOff,
+                        sampleRate, FRAMES_PER_BUFFER, paClipOff,
                         audioCallback, nullptr);
     if (err != paNoError) {
         std::cerr << "Pa_OpenStream failed: " << Pa_GetErrorText(err) << "\n";
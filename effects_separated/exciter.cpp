@@ -10,9 +10,10 @@
 #endif
 
 // ---------- Config (tweak these) ----------
-constexpr int SAMPLE_RATE       = 48000;
 constexpr unsigned FRAMES_PER_BUFFER = 256;
 
+static double sampleRate = 48000.0;   // the input device's, set in main()
+
 // Exciter params (tweak to taste)
 constexpr float DRY_GAIN      = 0.6f;   // dry mix level
 constexpr float WET_GAIN      = 0.9f;   // wet (processed) mix level
@@ -28,7 +29,7 @@ struct OnePole {
     float z1 = 0.0f;
     void setCutoff(float fc) {
         // bilinear-style single-pole alpha (leaky integrator)
-        float x = expf(-2.0f * (float)M_PI * fc / (float)SAMPLE_RATE);
+        float x = expf(-2.0f * (float)M_PI * fc / (float)sampleRate);
         b1 = x;
         a0 = 1.0f - x;
     }
@@ -101,12 +102,6 @@ static int audioCallback(const void* inputBuffer, void* outputBuffer,
 
 // ---------- Main ----------
 int main() {
-    // init filters
-    lpLow.setCutoff(HIGH_CUTOFF);
-    lpSmooth.setCutoff(SMOOTH_CUTOFF);
-    lpLow.reset();
-    lpSmooth.reset();
-
     PaError err = Pa_Initialize();
     if (err != paNoError) {
         std::cerr << "PortAudio init failed: " << Pa_GetErrorText(err) << "\n";
@@ -140,6 +135,13 @@ int main() {
         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
     }
 
+    // init filters for the device's rate
+    sampleRate = Pa_GetDeviceInfo(inputIndex)->defaultSampleRate;
+    lpLow.setCutoff(HIGH_CUTOFF);
+    lpSmooth.setCutoff(SMOOTH_CUTOFF);
+    lpLow.reset();
+    lpSmooth.reset();
+
     // prepare stream params
     PaStreamParameters inParams{};
     inParams.device = inputIndex;
@@ -159,7 +161,7 @@ int main() {
     err = Pa_OpenStream(&stream,
                         &inParams,
                         &outParams,
-                        SAMPLE_RATE,
+                        sampleRate,
                         FRAMES_PER_BUFFER,
                         paClipOff,
                         audioCallback,
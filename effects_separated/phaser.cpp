@@ -12,8 +12,8 @@
 #endif
 
 // ---------- CONFIG ----------
-constexpr int SAMPLE_RATE = 48000;
 constexpr unsigned FRAMES_PER_BUFFER = 256;
+static double sampleRate = 48000.0;   // the input device's, set in main()
 
 // Phaser parameters (tweak these)
 int NUM_STAGES = 6;                // number of all-pass stages (4..8 typical)
@@ -24,6 +24,9 @@ float FEEDBACK = 0.30f;            // 0..0.9 (resonance)
 float MIX = 0.60f;                 // 0 = dry, 1 = fully wet
 float STEREO_PHASE_OFFSET = M_PI/2; // 90 deg between L/R LFO
 
+constexpr int MAX_STAGES = 8;
+constexpr unsigned CONTROL_RATE = 32;   // samples between coefficient updates
+
 // ---------- All-pass stage state ----------
 struct APStage {
     float x1 = 0.0f; // x[n-1]
@@ -35,7 +38,13 @@ static std::vector<APStage> apL, apR;
 
 // LFO state
 static double lfoPhase = 0.0;
-static double lfoInc = 2.0 * M_PI * LFO_RATE_HZ / SAMPLE_RATE;
+static double lfoInc = 0.0;          // set once the rate is known
+
+// Coefficients are computed every CONTROL_RATE samples and ramped linearly
+// in between, instead of NUM_STAGES tanf calls per channel per sample
+static float coeffsL[MAX_STAGES], coeffsR[MAX_STAGES];
+static float stepL[MAX_STAGES], stepR[MAX_STAGES];
+static unsigned controlCountdown = 0;
 
 // simple clamp
 static inline float clampf(float v, float a, float b){ return v < a ? a : (v > b ? b : v); }
@@ -44,9 +53,9 @@ static inline float clampf(float v, float a, float b){ return v < a ? a : (v > b
 // using bilinear transform trick: a = (1 - tan(w0/2)) / (1 + tan(w0/2)), with w0 = 2*pi*fc/fs
 static inline float coeffForFreq(float fc) {
     // avoid Nyquist / 0
-    float nyq = SAMPLE_RATE * 0.5f;
+    float nyq = (float)sampleRate * 0.5f;
     fc = clampf(fc, 1.0f, nyq - 10.0f);
-    float w0 = 2.0f * (float)M_PI * fc / (float)SAMPLE_RATE;
+    float w0 = 2.0f * (float)M_PI * fc / (float)sampleRate;
     float t = tanf(w0 * 0.5f);
     // protect against extreme values
     if (!std::isfinite(t)) t = 1e3f;
@@ -54,8 +63,27 @@ static inline float coeffForFreq(float fc) {
     return a;
 }
 
+// per-stage coeffs for both channels at an LFO phase
+static void stageCoeffs(double phase, float* cl, float* cr) {
+    // compute LFO values for left & right (phase offset for stereo)
+    float lfoL = 0.5f * (1.0f + sinf((float)phase)); // 0..1
+    float lfoR = 0.5f * (1.0f + sinf((float)(phase + STEREO_PHASE_OFFSET)));
+
+    // map to frequency range
+    float fcL = MIN_FREQ_HZ + lfoL * (MAX_FREQ_HZ - MIN_FREQ_HZ);
+    float fcR = MIN_FREQ_HZ + lfoR * (MAX_FREQ_HZ - MIN_FREQ_HZ);
+
+    // compute per-stage coeffs — small detune across stages optional (we'll stagger slightly)
+    for (int s = 0; s < NUM_STAGES; ++s) {
+        // optionally stagger center for each stage to widen notches slightly
+        float stageOffset = 1.0f + 0.02f * (float)s; // tiny shift
+        cl[s] = coeffForFreq(fcL * stageOffset);
+        cr[s] = coeffForFreq(fcR * stageOffset);
+    }
+}
+
 // process one sample through N cascaded first-order all-pass sections (coeffs provided)
-static float processAllPassChain(std::vector<APStage> &stages, const std::vector<float> &coeffs, float input) {
+static float processAllPassChain(std::vector<APStage> &stages, const float* coeffs, float input) {
     float x = input;
     for (size_t s = 0; s < stages.size(); ++s) {
         float a = coeffs[s];
@@ -86,25 +114,18 @@ static int audioCallback(const void* inputBuffer, void* outputBuffer,
         return paContinue;
     }
 
-    // Pre-allocate coeff vectors (per-sample we update them)
-    std::vector<float> coeffsL(NUM_STAGES);
-    std::vector<float> coeffsR(NUM_STAGES);
-
     for (unsigned long n = 0; n < framesPerBuffer; ++n) {
-        // compute LFO values for left & right (phase offset for stereo)
-        float lfoL = 0.5f * (1.0f + std::sinf((float)lfoPhase)); // 0..1
-        float lfoR = 0.5f * (1.0f + std::sinf((float)(lfoPhase + STEREO_PHASE_OFFSET)));
-
-        // map to frequency range
-        float fcL = MIN_FREQ_HZ + lfoL * (MAX_FREQ_HZ - MIN_FREQ_HZ);
-        float fcR = MIN_FREQ_HZ + lfoR * (MAX_FREQ_HZ - MIN_FREQ_HZ);
-
-        // compute per-stage coeffs — small detune across stages optional (we'll stagger slightly)
-        for (int s = 0; s < NUM_STAGES; ++s) {
-            // optionally stagger center for each stage to widen notches slightly
-            float stageOffset = 1.0f + 0.02f * (float)s; // tiny shift
-            coeffsL[s] = coeffForFreq(fcL * stageOffset);
-            coeffsR[s] = coeffForFreq(fcR * stageOffset);
+        if (controlCountdown == 0) {
+            // advance LFO to the next control point and ramp towards it
+            lfoPhase += lfoInc * CONTROL_RATE;
+            if (lfoPhase >= 2.0 * M_PI) lfoPhase -= 2.0 * M_PI;
+            float nextL[MAX_STAGES], nextR[MAX_STAGES];
+            stageCoeffs(lfoPhase, nextL, nextR);
+            for (int s = 0; s < NUM_STAGES; ++s) {
+                stepL[s] = (nextL[s] - coeffsL[s]) / CONTROL_RATE;
+                stepR[s] = (nextR[s] - coeffsR[s]) / CONTROL_RATE;
+            }
+            controlCountdown = CONTROL_RATE;
         }
 
         // read input
@@ -135,9 +156,12 @@ static int audioCallback(const void* inputBuffer, void* outputBuffer,
         out[2*n + 0] = soft(outL);
         out[2*n + 1] = soft(outR);
 
-        // advance LFO
-        lfoPhase += lfoInc;
-        if (lfoPhase >= 2.0 * M_PI) lfoPhase -= 2.0 * M_PI;
+        // ramp coefficients
+        for (int s = 0; s < NUM_STAGES; ++s) {
+            coeffsL[s] += stepL[s];
+            coeffsR[s] += stepR[s];
+        }
+        --controlCountdown;
     }
 
     return paContinue;
@@ -146,12 +170,10 @@ static int audioCallback(const void* inputBuffer, void* outputBuffer,
 // ---------- Main ----------
 int main() {
     // init states
+    if (NUM_STAGES > MAX_STAGES) NUM_STAGES = MAX_STAGES;
     apL.resize(NUM_STAGES);
     apR.resize(NUM_STAGES);
 
-    // compute lfoInc in case SAMPLE_RATE changed
-    lfoInc = 2.0 * M_PI * LFO_RATE_HZ / SAMPLE_RATE;
-
     PaError err = Pa_Initialize();
     if (err != paNoError) {
         std::cerr << "PortAudio init error: " << Pa_GetErrorText(err) << "\n";
@@ -191,6 +213,11 @@ int main() {
         return 1;
     }
 
+    // LFO and coefficients for the device's rate
+    sampleRate = Pa_GetDeviceInfo(inputIndex)->defaultSampleRate;
+    lfoInc = 2.0 * M_PI * LFO_RATE_HZ / sampleRate;
+    stageCoeffs(lfoPhase, coeffsL, coeffsR);
+
     // open stream
     PaStreamParameters inParams{};
     inParams.device = inputIndex;
@@ -208,7 +235,7 @@ int main() {
 
     PaStream* stream = nullptr;
     err = Pa_OpenStream(&stream, &inParams, &outParams,
-                        SAMPLE_RATE, FRAMES_PER_BUFFER,
+                        sampleRate, FRAMES_PER_BUFFER,
                         paClipOff, audioCallback, nullptr);
     if (err != paNoError) {
         std::cerr << "Pa_OpenStream failed: " << Pa_GetErrorText(err) << "\n";
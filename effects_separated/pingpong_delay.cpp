@@ -9,7 +9,6 @@
 #define M_PI 3.14159265358979323846
 #endif
 
-constexpr int SAMPLE_RATE = 48000;
 constexpr unsigned FRAMES_PER_BUFFER = 256;
 
 // Effect parameters (tweak these constants)
@@ -22,8 +21,8 @@ constexpr float DELAY_MS_R  = 550.0f;  // right delay in ms (ping-pong)
 
 struct Lowpass {
     float a0=1.f, b1=0.f, z1=0.f;
-    void setCutoff(float fc) {
-        float x = expf(-2.0f * M_PI * fc / SAMPLE_RATE);
+    void setCutoff(float fc, double sampleRate) {
+        float x = expf(-2.0f * M_PI * fc / sampleRate);
         b1 = x;
         a0 = 1.0f - x;
     }
@@ -36,20 +35,23 @@ struct Lowpass {
 
 class PingPongDelay {
 public:
-    PingPongDelay()
+    // buffers and filter for the stream's rate
+    void prepare(double sr)
     {
-        size_t maxSamples = (size_t)(SAMPLE_RATE * 2.0f) + 10; // up to 2s
+        sampleRate = sr;
+        size_t maxSamples = (size_t)(sampleRate * 2.0) + 10; // up to 2s
         bufL.assign(maxSamples, 0.0f);
         bufR.assign(maxSamples, 0.0f);
         writePos = 0;
         // set defaults
         setDelayMs(DELAY_MS_L, DELAY_MS_R);
-        fbLowpass.setCutoff(LOWPASS_CUT);
+        fbLowpassL.setCutoff(LOWPASS_CUT, sampleRate);
+        fbLowpassR.setCutoff(LOWPASS_CUT, sampleRate);
     }
 
     void setDelayMs(float dLms, float dRms) {
-        delaySamplesL = (int)std::round(dLms * 0.001f * SAMPLE_RATE);
-        delaySamplesR = (int)std::round(dRms * 0.001f * SAMPLE_RATE);
+        delaySamplesL = (int)std::round(dLms * 0.001f * sampleRate);
+        delaySamplesR = (int)std::round(dRms * 0.001f * sampleRate);
         if (delaySamplesL < 1) delaySamplesL = 1;
         if (delaySamplesR < 1) delaySamplesR = 1;
         bufMask = (int)bufL.size() - 1;
@@ -79,8 +81,8 @@ public:
         float fbToR = delayedL * FEEDBACK;
 
         // lowpass the feedback to avoid bright buildup
-        fbToL = fbLowpass.process(fbToL);
-        fbToR = fbLowpass.process(fbToR);
+        fbToL = fbLowpassL.process(fbToL);
+        fbToR = fbLowpassR.process(fbToR);
 
         // write new samples into buffer (input + feedback)
         bufL[writePos] = in + fbToL;
@@ -94,16 +96,17 @@ public:
         std::fill(bufL.begin(), bufL.end(), 0.0f);
         std::fill(bufR.begin(), bufR.end(), 0.0f);
         writePos = 0;
-        fbLowpass.z1 = 0.0f;
+        fbLowpassL.z1 = fbLowpassR.z1 = 0.0f;
     }
 
 private:
     std::vector<float> bufL, bufR;
-    size_t writePos;
+    size_t writePos = 0;
+    double sampleRate = 48000.0;
     int delaySamplesL = 0;
     int delaySamplesR = 0;
     int bufMask = 0;
-    Lowpass fbLowpass;
+    Lowpass fbLowpassL, fbLowpassR;   // one per side
 };
 
 // Global instance
@@ -178,12 +181,9 @@ int main() {
         std::cin.ignore(10000, '\n');
     }
 
-    // configure delay settings (you can tweak here)
-    gDelay.setDelayMs(DELAY_MS_L, DELAY_MS_R);
-
-    // lowpass cutoff (feedback)
-    // (re-create lowpass with cutoff)
-    // done in constructor; if you want different cutoff, adjust in code
+    // buffers, delay settings and feedback lowpass for the device's rate
+    const double sampleRate = Pa_GetDeviceInfo(inputIndex)->defaultSampleRate;
+    gDelay.prepare(sampleRate);
 
     // open stream
     PaStreamParameters inParams{};
@@ -202,7 +202,7 @@ int main() {
 
     PaStream* stream = nullptr;
     err = Pa_OpenStream(&stream, &inParams, &outParams,
-                        SAMPLE_RATE, FRAMES_PER_BUFFER, paClipOff,
+                        sampleRate, FRAMES_PER_BUFFER, paClipOff,
                         audioCallback, nullptr);
     if (err != paNoError) {
         std::cerr << "Pa_OpenStream failed: " << Pa_GetErrorText(err) << "\n";
@@ -4,12 +4,12 @@
 #include <portaudio.h>
 #include <cstring>
 
-#define SAMPLE_RATE 48000
 #define FRAMES_PER_BUFFER 256
 
 // Delay time in ms
 static float delayMs = 2.0f;     // change this to taste
 static int delaySamples;
+static double sampleRate = 48000.0;   // the input device's, set in main()
 
 // Circular buffer
 static std::vector<float> delayBuffer;
@@ -50,9 +50,6 @@ static int audioCallback(const void* inputBuffer, void* outputBuffer,
 }
 
 int main() {
-    delaySamples = int((delayMs / 1000.0f) * SAMPLE_RATE);
-    delayBuffer.resize(SAMPLE_RATE * 0.01);  // 10ms buffer
-
     Pa_Initialize();
 
     int devCount = Pa_GetDeviceCount();
@@ -67,6 +64,11 @@ int main() {
     std::cout << "\nSelect INPUT device: ";
     std::cin >> inputIndex;
 
+    // Delay sized for the device's rate
+    sampleRate = Pa_GetDeviceInfo(inputIndex)->defaultSampleRate;
+    delaySamples = int((delayMs / 1000.0f) * sampleRate);
+    delayBuffer.resize(sampleRate * 0.01);  // 10ms buffer
+
     PaStreamParameters inP{}, outP{};
     inP.device = inputIndex;
     inP.channelCount = 1;
@@ -80,7 +82,7 @@ int main() {
 
     PaStream* stream;
     Pa_OpenStream(&stream, &inP, &outP,
-                  SAMPLE_RATE, FRAMES_PER_BUFFER, paNoFlag,
+                  sampleRate, FRAMES_PER_BUFFER, paNoFlag,
                   audioCallback, nullptr);
 
     Pa_StartStream(stream);
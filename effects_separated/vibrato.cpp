@@ -4,20 +4,26 @@
 #include <vector>
 #include <portaudio.h>
 
-#define SAMPLE_RATE 48000
 #define FRAMES_PER_BUFFER 256
-#define MAX_DELAY_SAMPLES 1024  // max vibrato delay (~20ms)
 #define M_PI 3.14159265358979323846
 
 struct Vibrato {
     std::vector<float> delayBuf;
     int writeIdx = 0;
+    int maxDelay = 1;
+    double sampleRate = 48000.0;
 
-    float depth = 18.0f;     // in samples (~0.1ms per sample)
+    float depthMs = 0.375f;  // 18 samples at 48 kHz
+    float depth = 18.0f;     // in samples
     float rate = 2.0f;      // Hz
 
-    Vibrato() {
-        delayBuf.resize(MAX_DELAY_SAMPLES, 0.0f);
+    // buffer and depth for the stream's rate
+    void prepare(double sr) {
+        sampleRate = sr;
+        depth = depthMs * 0.001f * (float)sr;
+        maxDelay = (int)std::ceil(2.0f * depth) + 2;
+        delayBuf.assign(maxDelay, 0.0f);
+        writeIdx = 0;
     }
 
     float process(float input, int sampleIndex) {
@@ -25,21 +31,21 @@ struct Vibrato {
         delayBuf[writeIdx] = input;
 
         // calculate LFO
-        float lfo = sinf(2.0f * M_PI * rate * sampleIndex / SAMPLE_RATE);
+        float lfo = sinf(2.0f * M_PI * rate * sampleIndex / sampleRate);
         float readDelay = depth * lfo + depth; // offset for positive index
 
         // read index with wrapping
         float readIdx = writeIdx - readDelay;
-        if (readIdx < 0) readIdx += MAX_DELAY_SAMPLES;
+        if (readIdx < 0) readIdx += maxDelay;
 
         // linear interpolation
         int i1 = int(readIdx);
-        int i2 = (i1 + 1) % MAX_DELAY_SAMPLES;
+        int i2 = (i1 + 1) % maxDelay;
         float frac = readIdx - i1;
         float output = delayBuf[i1] * (1.0f - frac) + delayBuf[i2] * frac;
 
         // increment write index
-        writeIdx = (writeIdx + 1) % MAX_DELAY_SAMPLES;
+        writeIdx = (writeIdx + 1) % maxDelay;
 
         return output;
     }
@@ -90,6 +96,9 @@ int main() {
     std::cout << "\nSelect input device index: ";
     std::cin >> inputIndex;
 
+    // Run at the device's rate
+    vibrato.prepare(Pa_GetDeviceInfo(inputIndex)->defaultSampleRate);
+
     PaStreamParameters inParams{};
     inParams.device = inputIndex;
     inParams.channelCount = 1;
@@ -104,7 +113,7 @@ int main() {
 
     PaStream* stream = nullptr;
     Pa_OpenStream(&stream, &inParams, &outParams,
-                  SAMPLE_RATE, FRAMES_PER_BUFFER,
+                  vibrato.sampleRate, FRAMES_PER_BUFFER,
                   paClipOff, audioCallback, nullptr);
 
     Pa_StartStream(stream);
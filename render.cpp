@@ -0,0 +1,265 @@
+// render.cpp - offline WAV renderer, runs effects/ chains as fast as the CPU allows
+// compile: g++ -std=c++17 -O2 render.cpp wav_file.cpp effects/*.cpp -pthread -o render
+//
+//   render [options] <in.wav> <out.wav>
+//   render [options] <in_dir> <out_dir>     every .wav in in_dir, one file per core
+//
+// options:
+//   -c, --chain a,b,c   effects in processing order (default phaser,exciter,reverb)
+//   -b, --block N       frames per block (default 8192)
+//   -j, --jobs N        worker threads for directory mode (default: all cores)
+//   -t, --tail SEC      silence appended so tails ring out (default 2)
+//   -i, --ir FILE       impulse response for cabinet stages
+//   -l, --list          list effect names
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <filesystem>
+
+#include "wav_file.h"
+#include "effects/any_effect.h"
+#include "effects/denormal.h"
+
+namespace fs = std::filesystem;
+
+struct Options {
+    std::vector<std::string> chain = { "phaser", "exciter", "reverb" };
+    size_t block = 8192;
+    unsigned jobs = 0;
+    float tailSec = 2.0f;
+    std::vector<float> ir;          // for cabinet stages, loaded once
+    int irRate = 0;
+};
+
+static std::mutex gLogMutex;
+
+// ------------------ Chain ----------------------------
+// Mono until the first stereo-output effect; every effect after that runs
+// as an independent instance per channel.
+class RenderChain {
+public:
+    bool build(const std::vector<std::string>& names, const Options& opt, std::string& error) {
+        bool stereo = false;
+        for (const std::string& n : names) {
+            Stage s;
+            s.fx[0] = AnyEffect::create(n);
+            if (!s.fx[0]) { error = "unknown effect '" + n + "'"; return false; }
+            s.split = !stereo && s.fx[0]->stereoOut();
+            if (stereo) s.fx[1] = AnyEffect::create(n);
+            stereo = stereo || s.split;
+            if (!opt.ir.empty())
+                for (auto& fx : s.fx)
+                    if (fx) fx->setImpulse(opt.ir.data(), opt.ir.size(), opt.irRate);
+            stages.push_back(std::move(s));
+        }
+        return true;
+    }
+
+    void prepare(int sampleRate, size_t maxBlock) {
+        for (Stage& s : stages)
+            for (auto& fx : s.fx)
+                if (fx) fx->prepare(sampleRate);
+        right.assign(maxBlock, 0.0f);
+    }
+
+    // in: mono block; L and R may alias in
+    void process(float* L, float*& R, size_t n) {
+        R = L;
+        for (Stage& s : stages) {
+            if (s.split) {
+                s.fx[0]->processBlockStereo(L, L, right.data(), n);
+                R = right.data();
+            } else if (s.fx[1]) {
+                s.fx[0]->processBlock(L, L, n);
+                s.fx[1]->processBlock(R, R, n);
+            } else {
+                s.fx[0]->processBlock(L, L, n);
+            }
+        }
+    }
+
+private:
+    struct Stage {
+        std::unique_ptr<AnyEffect> fx[2];
+        bool split = false;
+    };
+    std::vector<Stage> stages;
+    std::vector<float> right;
+};
+
+// ------------------ One file -------------------------
+static bool renderFile(const std::string& inPath, const std::string& outPath,
+                       const Options& opt)
+{
+    std::string error;
+    WavReader reader;
+    if (!reader.open(inPath, error)) {
+        std::lock_guard<std::mutex> lock(gLogMutex);
+        std::cerr << error << "\n";
+        return false;
+    }
+
+    RenderChain chain;
+    if (!chain.build(opt.chain, opt, error)) {
+        std::lock_guard<std::mutex> lock(gLogMutex);
+        std::cerr << error << "\n";
+        return false;
+    }
+    const int sr = reader.sampleRate();
+    chain.prepare(sr, opt.block);
+
+    WavWriter writer;
+    if (!writer.open(outPath, sr, 2, error)) {
+        std::lock_guard<std::mutex> lock(gLogMutex);
+        std::cerr << error << "\n";
+        return false;
+    }
+
+    std::vector<float> mono(opt.block);
+    std::vector<float> inter(opt.block * 2);
+    size_t tailLeft = (size_t)(opt.tailSec * sr);
+    size_t total = 0;
+
+    ScopedFlushDenormals flush;      // the appended tail decays into subnormals
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = true;
+    for (;;) {
+        size_t n = reader.readMono(mono.data(), opt.block);
+        if (n < opt.block && tailLeft > 0) {
+            size_t pad = std::min(opt.block - n, tailLeft);
+            std::fill(mono.begin() + n, mono.begin() + n + pad, 0.0f);
+            n += pad;
+            tailLeft -= pad;
+        }
+        if (n == 0) break;
+
+        float* R;
+        chain.process(mono.data(), R, n);
+        for (size_t i = 0; i < n; ++i) {
+            inter[2*i + 0] = mono[i];
+            inter[2*i + 1] = R[i];
+        }
+        if (!writer.write(inter.data(), n)) { ok = false; break; }
+        total += n;
+    }
+    ok = writer.close() && ok;
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    if (!ok) {
+        std::cerr << outPath << ": write failed\n";
+        return false;
+    }
+    double audioSecs = (double)total / sr;
+    std::cout << inPath << " -> " << outPath << "  "
+              << audioSecs << " s audio in " << secs << " s ("
+              << (secs > 0.0 ? audioSecs / secs : 0.0) << "x realtime)\n";
+    return true;
+}
+
+// ------------------ Directory ------------------------
+static bool renderDirectory(const fs::path& inDir, const fs::path& outDir, const Options& opt) {
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::directory_iterator(inDir)) {
+        if (!entry.is_regular_file()) continue;
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (ext == ".wav") files.push_back(entry.path());
+    }
+    std::sort(files.begin(), files.end());
+    if (files.empty()) {
+        std::cerr << "no .wav files in " << inDir << "\n";
+        return false;
+    }
+
+    std::error_code ec;
+    fs::create_directories(outDir, ec);
+
+    unsigned jobs = opt.jobs ? opt.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::min<unsigned>(jobs, (unsigned)files.size());
+
+    std::atomic<size_t> next(0);
+    std::atomic<int> failures(0);
+    auto worker = [&] {
+        for (size_t i; (i = next.fetch_add(1)) < files.size(); ) {
+            fs::path out = outDir / files[i].filename();
+            if (!renderFile(files[i].string(), out.string(), opt)) failures++;
+        }
+    };
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (unsigned j = 1; j < jobs; ++j) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::cout << files.size() << " files on " << jobs << " threads in " << secs << " s, "
+              << failures.load() << " failed\n";
+    return failures == 0;
+}
+
+// ------------------ MAIN -------------------------------
+static std::vector<std::string> splitList(const std::string& s) {
+    std::vector<std::string> out;
+    size_t start = 0;
+    while (start <= s.size()) {
+        size_t comma = s.find(',', start);
+        if (comma == std::string::npos) comma = s.size();
+        if (comma > start) out.push_back(s.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return out;
+}
+
+static void usage() {
+    std::cerr << "usage: render [-c a,b,c] [-b frames] [-j jobs] [-t tailSec] [-i ir.wav] <in.wav|dir> <out.wav|dir>\n"
+              << "       render -l\n";
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto value = [&]() -> const char* { return i + 1 < argc ? argv[++i] : ""; };
+        if (a == "-c" || a == "--chain")      opt.chain = splitList(value());
+        else if (a == "-b" || a == "--block") opt.block = (size_t)std::atol(value());
+        else if (a == "-j" || a == "--jobs")  opt.jobs = (unsigned)std::atoi(value());
+        else if (a == "-t" || a == "--tail")  opt.tailSec = (float)std::atof(value());
+        else if (a == "-i" || a == "--ir") {
+            std::string error;
+            if (!readWavMono(value(), opt.ir, opt.irRate, error)) {
+                std::cerr << error << "\n";
+                return 1;
+            }
+        }
+        else if (a == "-l" || a == "--list") {
+            for (const std::string& n : AnyEffect::names()) std::cout << n << "\n";
+            return 0;
+        }
+        else if (!a.empty() && a[0] == '-') { usage(); return 1; }
+        else paths.push_back(a);
+    }
+
+    if (paths.size() != 2 || opt.block == 0 || opt.tailSec < 0.0f) {
+        usage();
+        return 1;
+    }
+
+    bool ok;
+    if (fs::is_directory(paths[0]))
+        ok = renderDirectory(paths[0], paths[1], opt);
+    else
+        ok = renderFile(paths[0], paths[1], opt);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+#include "rt_setup.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#ifdef __linux__
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+// the smallest page size in use; touching every 4 KiB reaches every page
+static const size_t PAGE = 4096;
+
+// ---------------- Memory ----------------
+
+bool lockMemory(std::string& error) {
+#ifdef __linux__
+    // with MCL_FUTURE every later mapping counts against the limit and
+    // fails outright past it, so a small limit is refused here instead
+    rlimit lim;
+    const rlim_t NEEDED = 512ull * 1024 * 1024;
+    if (getrlimit(RLIMIT_MEMLOCK, &lim) == 0 && lim.rlim_cur != RLIM_INFINITY &&
+        lim.rlim_cur < NEEDED && geteuid() != 0) {
+        error = "memlock limit is " + std::to_string(lim.rlim_cur / 1024) +
+                " KiB; raise it to unlimited (ulimit -l unlimited, or a"
+                " '@audio - memlock unlimited' line in /etc/security/limits.conf)";
+        return false;
+    }
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        error = std::string("mlockall: ") + std::strerror(errno) +
+                (errno == EPERM ? " (needs CAP_IPC_LOCK or a memlock limit)" : "");
+        return false;
+    }
+    return true;
+#else
+    error = "memory locking not supported on this platform";
+    return false;
+#endif
+}
+
+void prefaultHeap(size_t bytes) {
+#ifdef __GLIBC__
+    // freed memory stays in the heap and large blocks come from it too,
+    // rather than from fresh mmap()s that fault on first touch
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    volatile char* p = (volatile char*)std::malloc(bytes);
+    if (!p) return;
+    for (size_t i = 0; i < bytes; i += PAGE) p[i] = 0;
+    std::free((void*)p);
+#else
+    (void)bytes;
+#endif
+}
+
+void prefaultStack() {
+    volatile char stack[STACK_PREFAULT];
+    for (size_t i = 0; i < STACK_PREFAULT; i += PAGE) stack[i] = 0;
+    (void)stack;
+}
+
+// ---------------- Scheduling ----------------
+
+bool makeRealtime(int priority, int core, std::string& error) {
+#ifdef __linux__
+    if (core >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof set, &set);
+        if (rc != 0) {
+            error = "can't pin to core " + std::to_string(core) + ": " + std::strerror(rc);
+            return false;
+        }
+    }
+    sched_param param{};
+    param.sched_priority = priority;
+    int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (rc != 0) {
+        error = std::string("SCHED_FIFO: ") + std::strerror(rc) +
+                (rc == EPERM ? " (needs CAP_SYS_NICE or an rtprio limit of at least " +
+                               std::to_string(priority) + ": ulimit -r, or an"
+                               " '@audio - rtprio 95' line in /etc/security/limits.conf)"
+                             : std::string());
+        return false;
+    }
+    return true;
+#else
+    (void)priority; (void)core;
+    error = "realtime scheduling not supported on this platform";
+    return false;
+#endif
+}
+
+bool canRealtime(int priority, std::string& error) {
+#ifdef __linux__
+    int policy;
+    sched_param old{};
+    pthread_getschedparam(pthread_self(), &policy, &old);
+    if (!makeRealtime(priority, -1, error)) return false;
+    pthread_setschedparam(pthread_self(), policy, &old);    // lowering is always allowed
+    return true;
+#else
+    return makeRealtime(priority, -1, error);
+#endif
+}
+
+int firstIsolatedCore() {
+    std::ifstream f("/sys/devices/system/cpu/isolated");
+    std::string list;
+    if (!f || !std::getline(f, list) || list.empty()) return -1;
+    return std::atoi(list.c_str());     // "2-3,6" starts with the lowest
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Startup steps that keep the audio thread off the page-fault and
+// scheduler paths (Linux; elsewhere each reports itself unsupported).
+// Every step is independent and best effort: false says which permission
+// or limit was missing, and the process carries on without it.
+//
+//   lockMemory()      mlockall, so nothing mapped now or later is paged out
+//                     and new mappings come in already faulted
+//   prefaultHeap()    grows the heap by that much, touched, and keeps malloc
+//                     from handing memory back, so allocations made later
+//                     (prepare(), graph swaps) reuse resident pages
+//   prefaultStack()   touches the calling thread's next STACK_PREFAULT bytes
+//   makeRealtime()    SCHED_FIFO at priority on one core, calling thread
+//   canRealtime()     whether makeRealtime() would be allowed, without
+//                     changing anything lasting
+
+const int AUDIO_PRIORITY = 80;                   // under the kernel's IRQ threads
+const size_t STACK_PREFAULT = 256 * 1024;
+const size_t HEAP_PREFAULT = 64 * 1024 * 1024;
+
+bool lockMemory(std::string& error);
+void prefaultHeap(size_t bytes);
+void prefaultStack();
+bool makeRealtime(int priority, int core, std::string& error);
+bool canRealtime(int priority, std::string& error);
+// first core in /sys/devices/system/cpu/isolated (isolcpus=), or -1
+int firstIsolatedCore();
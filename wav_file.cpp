@@ -0,0 +1,219 @@
+#include "wav_file.h"
+#include <cstring>
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ---------------- little-endian helpers ----------------
+static uint16_t rd16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t rd32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+static void wr16(char* p, uint16_t v) { p[0] = (char)(v & 0xff); p[1] = (char)(v >> 8); }
+static void wr32(char* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = (char)((v >> (8 * i)) & 0xff);
+}
+
+// ---------------- WavReader ----------------
+
+WavReader::~WavReader() {
+    close();
+}
+
+void WavReader::close() {
+#ifndef _WIN32
+    if (data) munmap((void*)data, size);
+#else
+    storage.clear();
+#endif
+    data = nullptr;
+    samples = nullptr;
+    size = 0;
+    numFrames = 0;
+    position = 0;
+}
+
+bool WavReader::open(const std::string& path, std::string& error) {
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) { error = "cannot open " + path; return false; }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 44) {
+        ::close(fd);
+        error = path + ": not a WAV file";
+        return false;
+    }
+    size = (size_t)st.st_size;
+    void* m = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED) { size = 0; error = "cannot map " + path; return false; }
+    madvise(m, size, MADV_SEQUENTIAL);
+    data = (const uint8_t*)m;
+#else
+    std::ifstream f(path, std::ios::binary);
+    if (!f) { error = "cannot open " + path; return false; }
+    storage.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    size = storage.size();
+    data = storage.data();
+#endif
+
+    if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) {
+        close();
+        error = path + ": not a RIFF/WAVE file";
+        return false;
+    }
+
+    bool haveFmt = false;
+    int format = 0, bitsPerSample = 0, validBits = 0;
+    size_t pos = 12;
+    while (pos + 8 <= size) {
+        const uint8_t* chunk = data + pos;
+        size_t len = rd32(chunk + 4);
+        const uint8_t* body = chunk + 8;
+        if (memcmp(chunk, "fmt ", 4) == 0 && len >= 16 && pos + 8 + len <= size) {
+            format = rd16(body);
+            numChannels = rd16(body + 2);
+            rate = (int)rd32(body + 4);
+            frameBytes = rd16(body + 12);
+            bitsPerSample = rd16(body + 14);
+            validBits = bitsPerSample;
+            if (format == 0xFFFE && len >= 26) { // WAVE_FORMAT_EXTENSIBLE
+                validBits = rd16(body + 18);
+                format = rd16(body + 24);
+            }
+            haveFmt = true;
+        } else if (memcmp(chunk, "data", 4) == 0 && haveFmt) {
+            if (len > size - pos - 8) len = size - pos - 8; // tolerate truncated files
+            samples = body;
+            numFrames = frameBytes ? len / frameBytes : 0;
+            break;
+        }
+        pos += 8 + len + (len & 1);
+    }
+
+    // frames are block align apart, one container per channel; samples
+    // with fewer valid bits sit at the top of theirs
+    sampleBytes = (bitsPerSample + 7) / 8;
+    if (haveFmt && numChannels > 0 && frameBytes != (size_t)numChannels * sampleBytes) {
+        close();
+        error = path + ": block align " + std::to_string(frameBytes) + " doesn't match " +
+                std::to_string(numChannels) + " channels of " + std::to_string(bitsPerSample) + "-bit samples";
+        return false;
+    }
+    isFloat = format == 3;
+    bool supported = validBits >= 1 && validBits <= bitsPerSample &&
+                     ((format == 1 && sampleBytes >= 2 && sampleBytes <= 4) ||
+                      (format == 3 && bitsPerSample == 32));
+    if (!samples || numChannels < 1 || rate <= 0 || !supported) {
+        close();
+        error = path + ": unsupported WAV format (need PCM 16/24/32 or float 32)";
+        return false;
+    }
+    return true;
+}
+
+size_t WavReader::readMono(float* out, size_t maxFrames) {
+    size_t n = numFrames - position;
+    if (n > maxFrames) n = maxFrames;
+
+    const int bytes = sampleBytes;
+    const int ch = numChannels;
+    const float gain = 1.0f / (float)ch;
+    const uint8_t* p = samples + position * frameBytes;
+
+    for (size_t i = 0; i < n; ++i) {
+        float sum = 0.0f;
+        for (int c = 0; c < ch; ++c, p += bytes) {
+            if (isFloat) {
+                float v;
+                memcpy(&v, p, 4);
+                sum += v;
+            } else if (bytes == 2) {
+                sum += (float)(int16_t)rd16(p) * (1.0f / 32768.0f);
+            } else if (bytes == 3) {
+                int32_t v = (int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24));
+                sum += (float)(v >> 8) * (1.0f / 8388608.0f);
+            } else {
+                sum += (float)(int32_t)rd32(p) * (1.0f / 2147483648.0f);
+            }
+        }
+        out[i] = sum * gain;
+    }
+
+    position += n;
+    return n;
+}
+
+// ---------------- WavWriter ----------------
+
+WavWriter::~WavWriter() {
+    close();
+}
+
+bool WavWriter::open(const std::string& path, int sampleRate, int channels, std::string& error) {
+    close();
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) { error = "cannot create " + path; return false; }
+
+    ioBuffer.resize(1 << 20);
+    std::setvbuf(file, ioBuffer.data(), _IOFBF, ioBuffer.size());
+
+    numChannels = channels;
+    framesWritten = 0;
+
+    // header is rewritten with real sizes on close()
+    char h[44] = {};
+    memcpy(h, "RIFF", 4);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    wr32(h + 16, 16);
+    wr16(h + 20, 3); // IEEE float
+    wr16(h + 22, (uint16_t)channels);
+    wr32(h + 24, (uint32_t)sampleRate);
+    wr32(h + 28, (uint32_t)(sampleRate * channels * 4));
+    wr16(h + 32, (uint16_t)(channels * 4));
+    wr16(h + 34, 32);
+    memcpy(h + 36, "data", 4);
+    return std::fwrite(h, 1, sizeof(h), file) == sizeof(h);
+}
+
+bool WavWriter::write(const float* interleaved, size_t frames) {
+    if (!file) return false;
+    size_t count = frames * (size_t)numChannels;
+    if (std::fwrite(interleaved, sizeof(float), count, file) != count) return false;
+    framesWritten += frames;
+    return true;
+}
+
+bool WavWriter::close() {
+    if (!file) return true;
+    uint64_t dataBytes = framesWritten * (uint64_t)numChannels * 4;
+    char sz[4];
+    bool ok = true;
+    wr32(sz, (uint32_t)(dataBytes + 36));
+    ok &= std::fseek(file, 4, SEEK_SET) == 0 && std::fwrite(sz, 1, 4, file) == 4;
+    wr32(sz, (uint32_t)dataBytes);
+    ok &= std::fseek(file, 40, SEEK_SET) == 0 && std::fwrite(sz, 1, 4, file) == 4;
+    ok &= std::fclose(file) == 0;
+    file = nullptr;
+    return ok;
+}
+
+// ---------------- helpers ----------------
+
+bool readWavMono(const std::string& path, std::vector<float>& out, int& sampleRate,
+                 std::string& error)
+{
+    WavReader reader;
+    if (!reader.open(path, error)) return false;
+    out.resize(reader.frames());
+    out.resize(reader.readMono(out.data(), out.size()));
+    sampleRate = reader.sampleRate();
+    return true;
+}
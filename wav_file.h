@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Reads a RIFF/WAVE file through a read-only memory mapping (a plain read
+// into memory on Windows). PCM in 16/24/32-bit containers and 32-bit float
+// are supported, WAVE_FORMAT_EXTENSIBLE with fewer valid bits (e.g. 24 in
+// 32) included; read() converts to float and downmixes to mono in
+// caller-sized chunks.
+class WavReader {
+public:
+    WavReader() = default;
+    ~WavReader();
+    WavReader(const WavReader&) = delete;
+    WavReader& operator=(const WavReader&) = delete;
+
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    int sampleRate() const { return rate; }
+    int channels() const { return numChannels; }
+    size_t frames() const { return numFrames; }
+
+    // returns frames written to out (0 at end of file)
+    size_t readMono(float* out, size_t maxFrames);
+
+    // start again from the first frame
+    void rewind() { position = 0; }
+
+private:
+    const uint8_t* data = nullptr;   // whole file
+    size_t size = 0;
+    const uint8_t* samples = nullptr; // start of the data chunk
+    size_t numFrames = 0;
+    size_t position = 0;
+    int rate = 0;
+    int numChannels = 0;
+    int sampleBytes = 0;             // container, per channel
+    size_t frameBytes = 0;           // the fmt chunk's block align
+    bool isFloat = false;
+
+#ifdef _WIN32
+    std::vector<uint8_t> storage;
+#endif
+};
+
+// Writes 32-bit float WAV. Sizes in the header are patched on close().
+class WavWriter {
+public:
+    WavWriter() = default;
+    ~WavWriter();
+    WavWriter(const WavWriter&) = delete;
+    WavWriter& operator=(const WavWriter&) = delete;
+
+    bool open(const std::string& path, int sampleRate, int channels, std::string& error);
+    // interleaved frames
+    bool write(const float* interleaved, size_t frames);
+    bool close();
+
+private:
+    std::FILE* file = nullptr;
+    int numChannels = 0;
+    uint64_t framesWritten = 0;
+    std::vector<char> ioBuffer;
+};
+
+// Whole file downmixed to mono, e.g. an impulse response. Allocates.
+bool readWavMono(const std::string& path, std::vector<float>& out, int& sampleRate,
+                 std::string& error);